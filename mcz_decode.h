@@ -0,0 +1,109 @@
+/*
+reference decoder of the compressed chip images (chipN.mcz) written by microcode_generator -z.
+small enough for the programmer's microcontroller: no heap, no table, one 16 byte row buffer,
+a copy reads the source row back from the eeprom that is being programmed.
+
+format: "MCZ1", uint16 row count (little endian), then tokens until every 16 byte row is written.
+the low 6 bits of a token are n, the token covers n + 1 rows:
+	00nnnnnn v          rows filled with byte v
+	01nnnnnn lo hi      copy of the rows starting at an earlier row (lo + hi * 256), the source may run into
+	                    the rows this token writes, they are copied one at a time in order
+	10nnnnnn 16 byte... literal rows
+	11nnnnnn v...       one byte per row, each row filled with its byte
+*/
+#ifndef MCZ_DECODE_H
+#define MCZ_DECODE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define MCZ_ROW 16
+#define MCZ_MAX_RUN 64
+
+enum mcz_token{
+	MCZ_FILL = 0x00,
+	MCZ_COPY = 0x40,
+	MCZ_LITERAL = 0x80,
+	MCZ_UNIFORM = 0xC0,
+};
+
+struct mcz_io{
+	int (*read_byte)(void *ctx);                                     //next byte of the stream, -1 at the end
+	void (*write_row)(void *ctx, uint16_t row, const uint8_t *data); //program one row
+	void (*read_row)(void *ctx, uint16_t row, uint8_t *data);        //read a row that is already programmed
+	void *ctx;
+};
+
+// decode one image, returns the number of rows written or -1 for a broken stream
+static int mcz_decode(const struct mcz_io *io)
+{
+	uint8_t row[MCZ_ROW];
+	uint16_t rows, at = 0;
+	int b0, b1;
+
+	for(int i = 0; i < 4; i++)
+		if(io->read_byte(io->ctx) != "MCZ1"[i])
+			return -1;
+	if((b0 = io->read_byte(io->ctx)) < 0 || (b1 = io->read_byte(io->ctx)) < 0)
+		return -1;
+	rows = (uint16_t) (b0 | b1 << 8);
+
+	while(at < rows)
+	{
+		int token = io->read_byte(io->ctx);
+		if(token < 0)
+			return -1;
+		int n = (token & 0x3F) + 1;
+		if(n > rows - at)
+			return -1;
+
+		switch(token & 0xC0)
+		{
+			case MCZ_FILL:
+				if((b0 = io->read_byte(io->ctx)) < 0)
+					return -1;
+				memset(row, b0, MCZ_ROW);
+				while(n--)
+					io->write_row(io->ctx, at++, row);
+				break;
+			case MCZ_COPY:
+			{
+				if((b0 = io->read_byte(io->ctx)) < 0 || (b1 = io->read_byte(io->ctx)) < 0)
+					return -1;
+				uint16_t from = (uint16_t) (b0 | b1 << 8);
+				if(from >= at)
+					return -1;
+				while(n--)
+				{
+					io->read_row(io->ctx, from++, row);
+					io->write_row(io->ctx, at++, row);
+				}
+				break;
+			}
+			case MCZ_LITERAL:
+				while(n--)
+				{
+					for(int i = 0; i < MCZ_ROW; i++)
+					{
+						if((b0 = io->read_byte(io->ctx)) < 0)
+							return -1;
+						row[i] = (uint8_t) b0;
+					}
+					io->write_row(io->ctx, at++, row);
+				}
+				break;
+			case MCZ_UNIFORM:
+				while(n--)
+				{
+					if((b0 = io->read_byte(io->ctx)) < 0)
+						return -1;
+					memset(row, b0, MCZ_ROW);
+					io->write_row(io->ctx, at++, row);
+				}
+				break;
+		}
+	}
+	return at;
+}
+
+#endif
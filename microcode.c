@@ -0,0 +1,4722 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "microcode.h"
+#include "microcode_tables.h"
+#include "mcz_decode.h"
+
+struct micro_code micro_code_list[]= {
+    
+    //NOP
+	{NOP+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{NOP+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{NOP+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{NOP+S3, NS0, CARE_DEFAULT},
+
+	{STP+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{STP+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{STP+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{STP+S3, NS3, CARE_DEFAULT},
+
+    //SHF
+	{RSF+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{RSF+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{RSF+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{RSF+S3, NS0 + ALU_SHF + LOAD_C, CARE_DEFAULT},
+
+    //ADD
+    {ADD+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{ADD+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{ADD+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{ADD+S3, NS0 + ALU_ADD + LOAD_C, CARE_DEFAULT},
+    
+	{ADDI+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{ADDI+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{ADDI+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{ADDI+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{ADDI+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{ADDI+S5, NS6 + GATE_MEM + LOAD_B, CARE_DEFAULT},
+	{ADDI+S6, NS0 + ALU_ADD + LOAD_C, CARE_DEFAULT},
+
+
+    //SUB
+	{SUB+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{SUB+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{SUB+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{SUB+S3, NS0 + ALU_SUB + LOAD_C + ADD_INC, CARE_DEFAULT}, //increment 1
+
+	{SUBI+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{SUBI+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{SUBI+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{SUBI+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{SUBI+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{SUBI+S5, NS6 + GATE_MEM + LOAD_B, CARE_DEFAULT},
+	{SUBI+S6, NS0 + ALU_SUB + LOAD_C + ADD_INC, CARE_DEFAULT}, //increment 1
+
+
+    //NOT
+	{NOT+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{NOT+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{NOT+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{NOT+S3, NS0 + ALU_NOT + LOAD_C, CARE_DEFAULT},
+
+    //XOR
+	{XOR+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{XOR+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{XOR+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{XOR+S3, NS0 + ALU_XOR + LOAD_C, CARE_DEFAULT},
+
+	{XORI+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{XORI+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{XORI+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{XORI+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{XORI+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{XORI+S5, NS6 + GATE_MEM + LOAD_B, CARE_DEFAULT},
+	{XORI+S6, NS0 + ALU_XOR + LOAD_C, CARE_DEFAULT},	
+	
+    //OR
+	{ORR+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{ORR+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{ORR+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{ORR+S3, NS0 + ALU_ORR + LOAD_C, CARE_DEFAULT},
+
+	{ORRI+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{ORRI+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{ORRI+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{ORRI+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{ORRI+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{ORRI+S5, NS6 + GATE_MEM + LOAD_B, CARE_DEFAULT},
+	{ORRI+S6, NS0 + ALU_ORR + LOAD_C, CARE_DEFAULT},			
+
+	//AND
+	{AND+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{AND+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{AND+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{AND+S3, NS0 + ALU_AND + LOAD_C, CARE_DEFAULT},
+
+	{ANDI+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{ANDI+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{ANDI+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{ANDI+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{ANDI+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{ANDI+S5, NS6 + GATE_MEM + LOAD_B, CARE_DEFAULT},
+	{ANDI+S6, NS0 + ALU_ORR + LOAD_C, CARE_DEFAULT},		
+
+	//JMP
+	{JMP+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{JMP+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{JMP+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{JMP+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{JMP+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{JMP+S5, NS6 + LOAD_C + GATE_MEM, CARE_DEFAULT},
+	{JMP+S6, NS7 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{JMP+S7, NS8 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{JMP+S8, NS9 + LOAD_PC0 + GATE_MEM, CARE_DEFAULT},
+	{JMP+S9, NS0 + LOAD_PC1 + GATE_C, CARE_DEFAULT},
+
+	/* not done: DEC, INC, PSH and POP still need a GATE_ALU signal and opcodes of their own
+	//DEC decrement
+	{DEC+S0, NS1 + LOAD_MAR0 + GATE_PC0 },
+	{DEC+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC}, 
+	{DEC+S2, NS3 + GATE_MEM + LOAD_IR}, 
+	//step1, get value from 0xFFFF, add 0xFF, store it back
+	{DEC+S3, NS4 + LOAD_A},
+	{DEC+S4, NS5 + LOAD_B + ALU_NOT + GATE_ALU + LOAD_MAR1+ LOAD_MAR0}, //put 0xFF into B put 0xFFFF into the MAR
+	{DEC+S5, NS6 + GATE_MEM + LOAD_A},//load content into A
+	{DEC+S6, NS7 + LOAD_C + GATE_ALU + ALU_ADD + GATE_MEM + WRITE},//add A with B(0xFF, which is -1), write back the result to 0xFFFF, save carry to reg C
+	//step2, get value from 0xFFFE, add 0xFF, add carry, store it back 
+	{DEC+S7, NS8 + LOAD_A},
+	{DEC+S8, NS9 + LOAD_A + LOAD_B + ALU_NOT + GATE_ALU}, //both A and B now have 0xFF
+	{DEC+S9, NS10 + LOAD_MAR0 + ALU_ADD + GATE_ALU}, // now the result should be 0xFE(0xFF+0xFF), 0xFFFE has loaded into MAR
+	{DEC+S10, NS11 + LOAD_A + GATE_MEM},
+	{DEC+S11, NS0 + GATE_ALU + ALU_ADD + GATE_MEM + WRITE},//save second byte
+	{DEC+S11+C, NS0 + GATE_ALU + ALU_ADD + ADD_INC + GATE_MEM + WRITE},//increment 1 as well if there is carry from step 1
+
+
+	//INC increment
+	{INC+S0, NS1 + LOAD_MAR0 + GATE_PC0 },
+	{INC+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC}, 
+	{INC+S2, NS3 + GATE_MEM + LOAD_IR}, 
+	//step1, get value from 0xFFFF, add 0xFF, store it back
+	{INC+S3, NS4 + LOAD_A + LOAD_B},//load 0 into A and B
+	{INC+S4, NS5 + ALU_NOT + GATE_ALU + LOAD_MAR1+ LOAD_MAR0}, //put 0xFFFF into the MAR
+	{INC+S5, NS6 + GATE_MEM + LOAD_A},//load content of 0xFFFF into A
+	{INC+S6, NS7 + LOAD_C + GATE_ALU + ALU_ADD + ADD_INC + GATE_MEM + WRITE},//add A by 1, write back the result to 0xFFFF, save carry to reg C
+	//step2, get value from 0xFFFE, add 0xFF, add carry, store it back 
+	{INC+S7, NS8 + LOAD_A},
+	{INC+S8, NS9 + LOAD_A + LOAD_B + ALU_NOT + GATE_ALU}, //both A and B now have 0xFF
+	{INC+S9, NS10 + LOAD_MAR0 + ALU_ADD + GATE_ALU}, // now the result should be 0xFE(0xFF+0xFF), 0xFFFE has loaded into MAR
+	{INC+S10, NS11 + LOAD_A + GATE_MEM},
+	{INC+S11, NS12 + LOAD_B} //load 0 into B
+	{INC+S12, NS0 + GATE_ALU + ALU_ADD + GATE_MEM + WRITE},//save second byte
+	{INC+S12+C, NS0 + GATE_ALU + ALU_ADD + ADD_INC + GATE_MEM + WRITE},//increment 1 as well if there is carry from step 1
+
+
+	//PUSH
+	{PSH+S0, NS1 + LOAD_MAR0 + GATE_PC0 },
+	{PSH+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC}, 
+	{PSH+S2, NS3 + GATE_MEM + LOAD_IR}, 
+	//step1, get value from 0xFFFF, decrement it, store it back
+	{PSH+S3, NS4 + LOAD_A},
+	{PSH+S4, NS5 + LOAD_B + ALU_NOT + GATE_ALU + LOAD_MAR1+ LOAD_MAR0}, //put 0xFFFF into the MAR
+	{PSH+S5, NS6 + GATE_MEM + LOAD_A},//A now points to the stack
+	{PSH+S6, NS7 + GATE_ALU + ALU_ADD + GATE_MEM + WRITE}, //A-1
+	//step2,
+	{PSH+S7, NS8 + LOAD_B},
+	{PSH+S8, NS9 + LOAD_MAR0 + ALU_ADD + GATE_ALU}, 
+	{PSH+S9, NS10 + GATE_C + GATE_MEM + WRITE},
+	{PSH+S10, NS11 + LOAD_A + GATE_MEM},
+	{PSH+S11, NS0 + GATE_ALU + ALU_ADD + GATE_MEM + WRITE},//save second byte
+	
+	//POP
+	{POP+S0, NS1 + LOAD_MAR0 + GATE_PC0 },
+	{POP+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC}, 
+	{POP+S2, NS3 + GATE_MEM + LOAD_IR}, 
+	//step1, get value from 0xFFFF, read from c, then increment the value
+	{POP+S3, NS4 + LOAD_A, LOAD_B}, //A=0, B=0
+	{POP+S4, NS5 + ALU_NOT + GATE_ALU + LOAD_MAR1+ LOAD_MAR0}, //put 0xFFFF into the MAR
+	{POP+S5, NS6 + GATE_MEM + LOAD_C + LOAD_A},//C and A now points to the stack
+	{PSH+S6, NS7 + GATE_ALU + ALU_ADD + ADD_INC + GATE_MEM + WRITE}, //A+1, store it back to 0xFFFF
+	//step2,
+	{POP+S8, NS9 + LOAD_MAR0 + GATE_C}, 
+	{POP+S9, NS10 + GATE_C + GATE_MEM + WRITE},
+	{POP+S10, NS11 + LOAD_A + GATE_MEM},
+	{POP+S11, NS0 + GATE_ALU + ALU_ADD + GATE_MEM + WRITE},//save second byte
+	*/
+
+	/*
+	//RET
+	{RET+S0, NS1 + LOAD_MAR0 + GATE_PC0 },
+	{RET+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC}, 
+	{RET+S2, NS3 + GATE_MEM + LOAD_IR}, 
+	{RET+S3, NS4 + LOAD_MAR0 + GATE_PC0 },
+	{RET+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC}, 
+	{RET+S5, NS6 + LOAD_C + GATE_MEM },
+	{RET+S6, NS7 + LOAD_MAR0 + GATE_PC0 },
+	{RET+S7, NS8 + LOAD_MAR1 + GATE_PC1 + INCR_PC}, 
+	{RET+S8, NS9 + LOAD_MAR0 + GATE_MEM + LOAD_A},
+	{RET+S9, NS10 + LOAD_MAR1 + GATE_C},
+	{RET+S10, NS11 + LOAD_PC1 + GATE_MEM},
+	{RET+S11, NS12 + LOAD_B}
+	{RET+S12, NS13 + LOAD_MAR0 + GATE_ALU + ALU_ADD}
+	{RET+S13, NS0 + LOAD_PC0, GATE_MEM}
+	*/
+
+	//LDA
+	{LDA+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDA+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDA+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{LDA+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDA+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDA+S5, NS6 + LOAD_C + GATE_MEM, CARE_DEFAULT},
+	{LDA+S6, NS7 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDA+S7, NS8 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDA+S8, NS9 + LOAD_MAR0 + GATE_MEM, CARE_DEFAULT},
+	{LDA+S9, NS10 + LOAD_MAR1 + GATE_C, CARE_DEFAULT},
+	{LDA+S10, NS0 + LOAD_A + GATE_MEM, CARE_DEFAULT},
+
+	{LDA+S0+MMIO, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDA+S1+MMIO, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDA+S2+MMIO, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{LDA+S3+MMIO, NS4 + INCR_PC, CARE_DEFAULT}, 
+	{LDA+S4+MMIO, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDA+S5+MMIO, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDA+S6+MMIO, NS6 + LOAD_IO + GATE_MEM, CARE_DEFAULT},
+	{LDA+S7+MMIO, NS0 + LOAD_A + GATE_IO, CARE_DEFAULT},
+
+	{MOVA+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{MOVA+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{MOVA+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{MOVA+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{MOVA+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{MOVA+S5, NS0 + LOAD_A + GATE_MEM, CARE_DEFAULT},
+
+	{LDA+S0+BYTE_ADDRESSING_MODE, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDA+S1+BYTE_ADDRESSING_MODE, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDA+S2+BYTE_ADDRESSING_MODE, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{LDA+S3+BYTE_ADDRESSING_MODE, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDA+S4+BYTE_ADDRESSING_MODE, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDA+S5+BYTE_ADDRESSING_MODE, NS6 + LOAD_MAR0 + GATE_MEM, CARE_DEFAULT},
+	{LDA+S10+BYTE_ADDRESSING_MODE, NS0 + LOAD_A + GATE_MEM, CARE_DEFAULT},
+
+	//the FAST_FETCH form of every opcode is derived from the sequences above, see derive_fast_fetch()
+
+	//LDB
+	{LDB+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDB+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDB+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{LDB+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDB+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDB+S5, NS6 + LOAD_C + GATE_MEM, CARE_DEFAULT},
+	{LDB+S6, NS7 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDB+S7, NS8 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDB+S8, NS9 + LOAD_MAR0 + GATE_MEM, CARE_DEFAULT},
+	{LDB+S9, NS10 + LOAD_MAR1 + GATE_C, CARE_DEFAULT},
+	{LDB+S10, NS0 + LOAD_B + GATE_MEM, CARE_DEFAULT},
+
+	{LDB+S0+MMIO, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDB+S1+MMIO, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDB+S2+MMIO, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{LDB+S3+MMIO, NS4 + INCR_PC, CARE_DEFAULT}, 
+	{LDB+S4+MMIO, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDB+S5+MMIO, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDB+S6+MMIO, NS6 + LOAD_IO + GATE_MEM, CARE_DEFAULT},
+	{LDB+S7+MMIO, NS0 + LOAD_B + GATE_IO, CARE_DEFAULT},
+
+	{MOVB+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{MOVB+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{MOVB+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{MOVB+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{MOVB+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{MOVB+S5, NS0 + LOAD_B + GATE_MEM, CARE_DEFAULT},
+
+	{LDB+S0+BYTE_ADDRESSING_MODE, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDB+S1+BYTE_ADDRESSING_MODE, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDB+S2+BYTE_ADDRESSING_MODE, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{LDB+S3+BYTE_ADDRESSING_MODE, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDB+S4+BYTE_ADDRESSING_MODE, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDB+S5+BYTE_ADDRESSING_MODE, NS6 + LOAD_MAR0 + GATE_MEM, CARE_DEFAULT},
+	{LDB+S10+BYTE_ADDRESSING_MODE, NS0 + LOAD_B + GATE_MEM, CARE_DEFAULT},
+
+	//LDC
+	{LDC+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDC+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDC+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{LDC+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDC+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDC+S5, NS6 + LOAD_C + GATE_MEM, CARE_DEFAULT},
+	{LDC+S6, NS7 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDC+S7, NS8 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDC+S8, NS9 + LOAD_MAR0 + GATE_MEM, CARE_DEFAULT},
+	{LDC+S9, NS10 + LOAD_MAR1 + GATE_C, CARE_DEFAULT},
+	{LDC+S10, NS0 + LOAD_C + GATE_MEM, CARE_DEFAULT},
+
+	{LDC+S0+MMIO, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDC+S1+MMIO, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDC+S2+MMIO, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{LDC+S3+MMIO, NS4 + INCR_PC, CARE_DEFAULT}, 
+	{LDC+S4+MMIO, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDC+S5+MMIO, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDC+S6+MMIO, NS6 + LOAD_IO + GATE_MEM, CARE_DEFAULT},
+	{LDC+S7+MMIO, NS0 + LOAD_C + GATE_IO, CARE_DEFAULT},
+
+	{MOVC+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{MOVC+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{MOVC+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{MOVC+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{MOVC+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{MOVC+S5, NS0 + LOAD_C + GATE_MEM, CARE_DEFAULT},
+
+	{LDC+S0+BYTE_ADDRESSING_MODE, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDC+S1+BYTE_ADDRESSING_MODE, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDC+S2+BYTE_ADDRESSING_MODE, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{LDC+S3+BYTE_ADDRESSING_MODE, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{LDC+S4+BYTE_ADDRESSING_MODE, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{LDC+S5+BYTE_ADDRESSING_MODE, NS6 + LOAD_MAR0 + GATE_MEM, CARE_DEFAULT},
+	{LDC+S10+BYTE_ADDRESSING_MODE, NS0 + LOAD_C + GATE_MEM, CARE_DEFAULT},
+
+	//STC
+	{STC+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{STC+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{STC+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{STC+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{STC+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{STC+S5, NS6 + LOAD_A + GATE_MEM, CARE_DEFAULT},
+	{STC+S6, NS7 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{STC+S7, NS8 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{STC+S8, NS9 + LOAD_MAR0 + GATE_MEM, CARE_DEFAULT},
+	{STC+S9, NS10 + LOAD_B, CARE_DEFAULT},
+	{STC+S10, NS11 + LOAD_MAR1 + ALU_XOR, CARE_DEFAULT},
+	{STC+S11, NS0 + GATE_C + GATE_MEM + WRITE, CARE_DEFAULT},
+
+	{STC+S0+MMIO, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{STC+S1+MMIO, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{STC+S2+MMIO, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{STC+S3+MMIO, NS4 + INCR_PC, CARE_DEFAULT}, 
+	{STC+S4+MMIO, NS5 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{STC+S5+MMIO, NS6 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{STC+S6+MMIO, NS7 + LOAD_IO + GATE_MEM, CARE_DEFAULT},
+	{STC+S7+MMIO, NS0 + GATE_C + WRITE_IO, CARE_DEFAULT},
+
+	{STC+S0+BYTE_ADDRESSING_MODE, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{STC+S1+BYTE_ADDRESSING_MODE, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{STC+S2+BYTE_ADDRESSING_MODE, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT}, 
+	{STC+S3+BYTE_ADDRESSING_MODE, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{STC+S4+BYTE_ADDRESSING_MODE, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{STC+S5+BYTE_ADDRESSING_MODE, NS6 + LOAD_MAR0 + GATE_MEM, CARE_DEFAULT},
+	{STC+S10+BYTE_ADDRESSING_MODE, NS0 + LOAD_B + GATE_MEM, CARE_DEFAULT},	
+
+
+	//
+	{-1, 0, 0}
+};
+
+struct micro_code jump_template[] = {
+	{JMP+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{JMP+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{JMP+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{JMP+S4, NS5 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{JMP+S5, NS6 + LOAD_C + GATE_MEM, CARE_DEFAULT},
+	{JMP+S6, NS7 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{JMP+S7, NS8 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT}, 
+	{JMP+S8, NS9 + LOAD_PC0 + GATE_MEM, CARE_DEFAULT},
+	{JMP+S9, NS0 + LOAD_PC1 + GATE_C, CARE_DEFAULT},
+	{-1, 0, 0}
+};
+
+
+/*
+interrupt entry, generated with -i. I is only looked at in S0: with I set the dispatch loads ir from the empty bus,
+which reads 0, so the entry runs in opcode 00 from INT_ENTRY (NOP itself only uses S0-S3).
+-i needs this on the board: pull-down resistors on the 8 bus lines, so a step that gates nothing onto the bus
+reads 0 and not whatever the last driver left on the lines. nothing in the tables can drive a 0, the dispatch relies on them.
+io port 0 is the interrupt controller and returns the vector page V. the pc is saved at V:00 (pc0) and V:01 (pc1),
+the handler starts at V:02 and ends with RTI. pc0 is saved first so the pc can count to 1 for the second address,
+RTI restores pc1 first for the same reason. the controller must not raise I again before RTI, there is one save area
+*/
+#define INT_ENTRY S4
+#define INT_DISPATCH (NS4 + LOAD_IR)
+
+struct micro_code interrupt_list[] = {
+	{NOP+S4, NS5 + LOAD_IO + LOAD_MAR0, CARE_DEFAULT},           //select port 0, MAR0 = 0
+	{NOP+S5, NS6 + LOAD_MAR1 + GATE_IO, CARE_DEFAULT},           //MAR1 = vector page
+	{NOP+S6, NS7 + GATE_PC0 + GATE_MEM + WRITE, CARE_DEFAULT},   //V:00 = pc0
+	{NOP+S7, NS8 + LOAD_PC0, CARE_DEFAULT},                      //pc0 = 0
+	{NOP+S8, NS9 + INCR_PC, CARE_DEFAULT},                       //pc0 = 1
+	{NOP+S9, NS10 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},         //MAR0 = 1
+	{NOP+S10, NS11 + GATE_PC1 + GATE_MEM + WRITE, CARE_DEFAULT}, //V:01 = pc1
+	{NOP+S11, NS12 + LOAD_PC1 + GATE_IO, CARE_DEFAULT},          //pc = V:01
+	{NOP+S12, NS0 + INCR_PC, CARE_DEFAULT},                      //pc = V:02, fetch the handler
+
+	{RTI+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{RTI+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{RTI+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{RTI+S3, NS4 + LOAD_IO + LOAD_PC0, CARE_DEFAULT},            //select port 0, pc0 = 0
+	{RTI+S4, NS5 + LOAD_MAR1 + GATE_IO + INCR_PC, CARE_DEFAULT}, //MAR1 = vector page, pc0 = 1
+	{RTI+S5, NS6 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},          //MAR0 = 1
+	{RTI+S6, NS7 + LOAD_PC1 + GATE_MEM, CARE_DEFAULT},           //pc1 = V:01
+	{RTI+S7, NS8 + LOAD_MAR0, CARE_DEFAULT},                     //MAR0 = 0
+	{RTI+S8, NS0 + LOAD_PC0 + GATE_MEM, CARE_DEFAULT},           //pc0 = V:00
+	{-1, 0, 0}
+};
+
+//mnemonic of every opcode and addressing mode, used by the reports
+struct opcode_name{
+	const char *name;
+	int32_t input;
+};
+
+const struct opcode_name opcode_names[] = {
+	{"NOP", NOP}, {"STP", STP}, {"RSF", RSF},
+	{"ADD", ADD}, {"ADDI", ADDI}, {"SUB", SUB}, {"SUBI", SUBI},
+	{"NOT", NOT}, {"XOR", XOR}, {"XORI", XORI}, {"ORR", ORR}, {"ORRI", ORRI}, {"AND", AND}, {"ANDI", ANDI},
+	{"JMP", JMP}, {"JC", JC}, {"JN", JN}, {"JZ", JZ}, {"JNC", JNC}, {"JZC", JZC}, {"JZN", JZN}, {"JZNC", JZNC},
+	{"LDA", LDA}, {"LDA_MMIO", LDA+MMIO}, {"MOVA", MOVA}, {"LDAB", LDAB},
+	{"LDB", LDB}, {"LDB_MMIO", LDB+MMIO}, {"MOVB", MOVB}, {"LDBB", LDBB},
+	{"LDC", LDC}, {"LDC_MMIO", LDC+MMIO}, {"MOVC", MOVC}, {"LDCB", LDCB},
+	{"STC", STC}, {"STC_MMIO", STC+MMIO}, {"STCB", STCB},
+	{"RTI", RTI},
+	{NULL, -1}
+};
+
+//ir byte of an instruction, the upper byte of its micro code address
+#define IR_OF(input) (((input) >> 8) & 0xFF)
+
+static const char *opcode_name(int ir)
+{
+	for(int i = 0; opcode_names[i].name; i++)
+		if(IR_OF(opcode_names[i].input) == ir)
+			return opcode_names[i].name;
+	return NULL;
+}
+
+/*
+an opcode is generated when its fetch is in the control store. RTI only is with -i, without it the ir runs the filler
+(NS0 at S0, no signal), which loops at S0 forever and must not be counted as a one cycle instruction
+*/
+static int opcode_generated(const control_word *store, int ir)
+{
+	for(int cond = 0; cond < 16; cond++)
+		if(store[ir << 8 | S0 | cond] != FILL_WORD)
+			return 1;
+	return 0;
+}
+
+// conditional jumps are the JMP opcodes with any of JMP_C/JMP_N/JMP_Z set
+static int is_conditional_jump(int ir)
+{
+	return (ir & 0xF8) == IR_OF(JMP) && (ir & IR_OF(JMP_C|JMP_N|JMP_Z)) != 0;
+}
+
+// milliseconds between two clock_gettime readings
+double elapsed_ms(struct timespec from, struct timespec to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000.0 + (to.tv_nsec - from.tv_nsec) / 1000000.0;
+}
+
+const struct microcode_def builtin_def = {"built in", micro_code_list, jump_template};
+
+//every #define a definition file can use, looked up through a perfect hash built at startup
+struct symbol{
+	const char *name;
+	int64_t value;
+};
+
+#define SYM(name) {#name, (int64_t) (name)}
+
+static const struct symbol symbols[] = {
+	SYM(NOP), SYM(STP), SYM(RSF), SYM(ADD), SYM(ADDI), SYM(SUB), SYM(SUBI), SYM(NOT), SYM(XOR), SYM(XORI),
+	SYM(ORR), SYM(ORRI), SYM(AND), SYM(ANDI),
+	SYM(JMP), SYM(JMPB), SYM(JMP_C), SYM(JMP_N), SYM(JMP_Z), SYM(JZ), SYM(JN), SYM(JC), SYM(JZN), SYM(JZC), SYM(JNC), SYM(JZNC),
+	SYM(LDA), SYM(MOVA), SYM(LDAB), SYM(LDB), SYM(MOVB), SYM(LDBB), SYM(LDC), SYM(MOVC), SYM(LDCB), SYM(STC), SYM(STCB), SYM(RTI),
+	SYM(MMIO), SYM(BYTE_ADDRESSING_MODE),
+	SYM(I), SYM(C), SYM(N), SYM(Z), SYM(MEM_READY), SYM(FAST_FETCH),
+	SYM(S0), SYM(S1), SYM(S2), SYM(S3), SYM(S4), SYM(S5), SYM(S6), SYM(S7),
+	SYM(S8), SYM(S9), SYM(S10), SYM(S11), SYM(S12), SYM(S13), SYM(S14), SYM(S15),
+	SYM(NS0), SYM(NS1), SYM(NS2), SYM(NS3), SYM(NS4), SYM(NS5), SYM(NS6), SYM(NS7),
+	SYM(NS8), SYM(NS9), SYM(NS10), SYM(NS11), SYM(NS12), SYM(NS13), SYM(NS14), SYM(NS15), SYM(NSJUMP),
+	SYM(STEP3), SYM(STEP2), SYM(STEP1), SYM(STEP0),
+	SYM(LOAD_MAR0), SYM(LOAD_MAR1), SYM(GATE_MEM), SYM(WRITE),
+	SYM(LOAD_IR), SYM(LOAD_A), SYM(LOAD_B), SYM(LOAD_C), SYM(GATE_C), SYM(ALU2), SYM(ALU1), SYM(ALU0),
+	SYM(ALU_NOP), SYM(ALU_SHF), SYM(ALU_ADD), SYM(ALU_SUB), SYM(ALU_NOT), SYM(ALU_XOR), SYM(ALU_ORR), SYM(ALU_AND), SYM(ADD_INC),
+	SYM(LOAD_PC0), SYM(LOAD_PC1), SYM(GATE_PC0), SYM(GATE_PC1), SYM(INCR_PC),
+	SYM(LOAD_IO), SYM(GATE_IO), SYM(WRITE_IO),
+};
+
+#define SYMBOL_COUNT ((int) (sizeof(symbols) / sizeof(symbols[0])))
+#define HASH_SLOTS 256   //power of 2, at least SYMBOL_COUNT
+#define HASH_BUCKETS 64
+
+static int16_t hash_slot[HASH_SLOTS];       //index into symbols, -1 when empty
+static uint16_t hash_displace[HASH_BUCKETS];
+
+static uint32_t hash_name(const char *name, size_t length, uint32_t seed)
+{
+	uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+	for(size_t i = 0; i < length; i++)
+		hash = (hash ^ (uint8_t) name[i]) * 16777619u;
+	return hash ^ (hash >> 15);
+}
+
+/*
+hash and displace: the names are grouped in buckets by one hash, the biggest bucket first
+gets the smallest displacement that puts all its names in free slots of the second hash.
+a lookup is then two hashes and one string compare
+*/
+static void build_symbol_hash(void)
+{
+	int bucket_of[SYMBOL_COUNT], order[HASH_BUCKETS], size[HASH_BUCKETS] = {0};
+
+	for(int i = 0; i < SYMBOL_COUNT; i++)
+	{
+		bucket_of[i] = hash_name(symbols[i].name, strlen(symbols[i].name), 0) % HASH_BUCKETS;
+		size[bucket_of[i]]++;
+	}
+	for(int b = 0; b < HASH_BUCKETS; b++)
+		order[b] = b;
+	for(int i = 1; i < HASH_BUCKETS; i++) //insertion sort, biggest bucket first
+		for(int j = i; j > 0 && size[order[j]] > size[order[j-1]]; j--)
+		{
+			int t = order[j]; order[j] = order[j-1]; order[j-1] = t;
+		}
+
+	memset(hash_slot, -1, sizeof(hash_slot));
+	for(int o = 0; o < HASH_BUCKETS && size[order[o]]; o++)
+	{
+		int b = order[o];
+		for(uint32_t d = 1; ; d++)
+		{
+			int slots[SYMBOL_COUNT], n = 0, ok = 1;
+			for(int i = 0; i < SYMBOL_COUNT && ok; i++)
+			{
+				if(bucket_of[i] != b)
+					continue;
+				int slot = hash_name(symbols[i].name, strlen(symbols[i].name), d) & (HASH_SLOTS - 1);
+				if(hash_slot[slot] >= 0)
+					ok = 0;
+				for(int k = 0; k < n; k++)
+					if(slots[k] == slot)
+						ok = 0;
+				slots[n++] = slot;
+			}
+			if(!ok)
+				continue;
+			n = 0;
+			for(int i = 0; i < SYMBOL_COUNT; i++)
+				if(bucket_of[i] == b)
+					hash_slot[slots[n++]] = i;
+			hash_displace[b] = d;
+			break;
+		}
+	}
+}
+
+// value of a symbol, returns 0 when the name is unknown
+static int lookup_symbol(const char *name, size_t length, int64_t *value)
+{
+	uint32_t d = hash_displace[hash_name(name, length, 0) % HASH_BUCKETS];
+	int index = hash_slot[hash_name(name, length, d) & (HASH_SLOTS - 1)];
+	if(index < 0 || strncmp(symbols[index].name, name, length) != 0 || symbols[index].name[length] != 0)
+		return 0;
+	*value = symbols[index].value;
+	return 1;
+}
+
+/*
+line oriented definition file:
+
+	# comment (// works as well)
+	define DEC 0xE000                   new name for the rest of the file
+	[micro_code]                        entries for micro_code_list
+	ADD+S3 : NS0 + ALU_ADD + LOAD_C
+	DEC+S11+C when C : NS0 + ...        only the addresses with C set (care mask WHEN(C))
+	[jump_template]                     entries expanded for every conditional jump
+
+expressions are sums of names and numbers (0x1F, 31), errors are reported as file:line:column
+*/
+struct parser{
+	FILE *out;           //where errors go
+	const char *file;
+	const char *line;    //start of the current line
+	int line_no;
+	int errors;
+	struct symbol *defines; //names from define lines
+	int define_count;
+};
+
+static void parse_error(struct parser *ps, const char *at, const char *message, const char *token, size_t length)
+{
+	const char *end = strchr(ps->line, '\n');
+	int column = (int) (at - ps->line) + 1;
+
+	fprintf(ps->out, "%s:%d:%d: error: %s", ps->file, ps->line_no, column, message);
+	if(token)
+		fprintf(ps->out, " '%.*s'", (int) length, token);
+	fprintf(ps->out, "\n  %.*s\n  %*s^\n", end ? (int) (end - ps->line) : (int) strlen(ps->line), ps->line, column - 1, "");
+	ps->errors++;
+}
+
+// value of a name from an earlier define line, returns 0 when there is none
+static int find_define(const struct parser *ps, const char *name, size_t length, int64_t *value)
+{
+	for(int i = 0; i < ps->define_count; i++)
+		if(strncmp(ps->defines[i].name, name, length) == 0 && ps->defines[i].name[length] == 0)
+		{
+			*value = ps->defines[i].value;
+			return 1;
+		}
+	return 0;
+}
+
+static const char *skip_space(const char *p)
+{
+	while(*p == ' ' || *p == '\t' || *p == '\r')
+		p++;
+	return p;
+}
+
+static int is_name_char(char c)
+{
+	return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// sum of names and numbers, *p is left after the expression, returns 0 after reporting an error
+static int parse_expression(struct parser *ps, const char **p, int64_t *value)
+{
+	*value = 0;
+	for(;;)
+	{
+		const char *start = *p = skip_space(*p);
+		int64_t term;
+
+		if(**p >= '0' && **p <= '9')
+		{
+			char *end;
+			term = (int64_t) strtoull(start, &end, 0);
+			*p = end;
+			if(is_name_char(**p))
+			{
+				parse_error(ps, start, "malformed number", NULL, 0);
+				return 0;
+			}
+		}
+		else if(is_name_char(**p))
+		{
+			while(is_name_char(**p))
+				(*p)++;
+			size_t length = *p - start;
+			if(!lookup_symbol(start, length, &term) && !find_define(ps, start, length, &term))
+			{
+				parse_error(ps, start, "unknown symbol", start, length);
+				return 0;
+			}
+		}
+		else
+		{
+			parse_error(ps, start, "expected a name or a number", NULL, 0);
+			return 0;
+		}
+		*value += term;
+		*p = skip_space(*p);
+		if(**p != '+')
+			return 1;
+		(*p)++;
+	}
+}
+
+static int at_line_end(const char *p)
+{
+	return *p == 0 || *p == '\n' || *p == '#' || (p[0] == '/' && p[1] == '/');
+}
+
+static void append_entry(struct micro_code **list, int *count, int *capacity, struct micro_code entry)
+{
+	if(*count + 1 >= *capacity)
+	{
+		*capacity = *capacity ? *capacity * 2 : 256;
+		*list = realloc(*list, *capacity * sizeof(**list));
+		if(*list == NULL)
+		{
+			printf("out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	(*list)[(*count)++] = entry;
+	(*list)[*count] = (struct micro_code){-1, 0, 0};
+}
+
+static pthread_once_t symbol_hash_once = PTHREAD_ONCE_INIT;
+
+/*
+parse a definition file, every error is reported to out with its location.
+returns the number of errors, def is only filled when there are none.
+the symbol hash is built by the first call, any number of files can be parsed at the same time
+*/
+int load_definition(const char *file_name, struct microcode_def *def, FILE *out)
+{
+	pthread_once(&symbol_hash_once, build_symbol_hash);
+	struct parser ps = {out, file_name, NULL, 0, 0, NULL, 0};
+	struct micro_code *lists[2] = {NULL, NULL};
+	int counts[2] = {0, 0}, capacities[2] = {0, 0}, define_capacity = 0;
+	int section = -1; //0 micro_code, 1 jump_template
+	struct stat st;
+
+	FILE *fPtr = fopen(file_name, "rb");
+	if(fPtr == NULL || fstat(fileno(fPtr), &st) != 0)
+	{
+		fprintf(out, "Unable to open file %s.\n", file_name);
+		if(fPtr)
+			fclose(fPtr);
+		return 1;
+	}
+	char *text = malloc(st.st_size + 1);
+	if(text == NULL || fread(text, 1, st.st_size, fPtr) != (size_t) st.st_size)
+	{
+		fprintf(out, "oh no, the read failed for %s!!!\n", file_name);
+		fclose(fPtr);
+		free(text);
+		return 1;
+	}
+	text[st.st_size] = 0;
+	fclose(fPtr);
+
+	for(const char *line = text; *line; )
+	{
+		const char *next = strchr(line, '\n');
+		next = next ? next + 1 : line + strlen(line);
+		ps.line = line;
+		ps.line_no++;
+
+		const char *p = skip_space(line);
+		if(at_line_end(p))
+		{
+			line = next;
+			continue;
+		}
+
+		if(*p == '[')
+		{
+			const char *name = ++p;
+			while(*p && *p != ']' && *p != '\n')
+				p++;
+			if(*p != ']')
+				parse_error(&ps, p, "expected ']'", NULL, 0);
+			else if(p - name == 10 && strncmp(name, "micro_code", 10) == 0)
+				section = 0;
+			else if(p - name == 13 && strncmp(name, "jump_template", 13) == 0)
+				section = 1;
+			else
+				parse_error(&ps, name, "unknown section", name, p - name);
+		}
+		else if(strncmp(p, "define", 6) == 0 && (p[6] == ' ' || p[6] == '\t'))
+		{
+			const char *name = p = skip_space(p + 6);
+			while(is_name_char(*p))
+				p++;
+			size_t length = p - name;
+			int64_t value;
+			if(length == 0)
+				parse_error(&ps, name, "expected a name after define", NULL, 0);
+			else if(lookup_symbol(name, length, &value))
+				parse_error(&ps, name, "define reuses a built in symbol", name, length);
+			else if(find_define(&ps, name, length, &value))
+				parse_error(&ps, name, "define repeats an earlier define", name, length);
+			else if(parse_expression(&ps, &p, &value))
+			{
+				if(ps.define_count == define_capacity)
+				{
+					int capacity = define_capacity ? define_capacity * 2 : 16;
+					struct symbol *defines = realloc(ps.defines, capacity * sizeof(*ps.defines));
+					if(defines == NULL)
+					{
+						parse_error(&ps, name, "out of memory", NULL, 0);
+						break;
+					}
+					ps.defines = defines;
+					define_capacity = capacity;
+				}
+				char *copy = malloc(length + 1);
+				if(copy == NULL)
+				{
+					parse_error(&ps, name, "out of memory", NULL, 0);
+					break;
+				}
+				memcpy(copy, name, length);
+				copy[length] = 0;
+				ps.defines[ps.define_count++] = (struct symbol){copy, value};
+				if(!at_line_end(p))
+					parse_error(&ps, p, "unexpected text after define", NULL, 0);
+			}
+		}
+		else if(section < 0)
+			parse_error(&ps, p, "entry outside of a [micro_code] or [jump_template] section", NULL, 0);
+		else
+		{
+			struct micro_code entry = {0, 0, 0};
+			int64_t input, cond, output = 0;
+			int ok = parse_expression(&ps, &p, &input);
+			if(ok && strncmp(p, "when", 4) == 0 && !is_name_char(p[4]))
+			{
+				p += 4;
+				ok = parse_expression(&ps, &p, &cond);
+				entry.care = WHEN((int32_t) cond);
+			}
+			if(ok && *p != ':')
+			{
+				parse_error(&ps, p, "expected ':' between address and control word", NULL, 0);
+				ok = 0;
+			}
+			if(ok)
+			{
+				p++;
+				ok = parse_expression(&ps, &p, &output);
+			}
+			if(ok && !at_line_end(p))
+			{
+				parse_error(&ps, p, "unexpected text after the control word", NULL, 0);
+				ok = 0;
+			}
+			if(ok && (input < 0 || input >= EEPROM_SIZE))
+			{
+				parse_error(&ps, skip_space(line), "address out of range", NULL, 0);
+				ok = 0;
+			}
+			if(ok && ((control_word) output & ~CONTROL_MASK))
+			{
+				parse_error(&ps, skip_space(line), "control word wider than the control chips", NULL, 0);
+				ok = 0;
+			}
+			if(ok)
+			{
+				entry.input = (int32_t) input;
+				entry.output = (control_word) output;
+				append_entry(&lists[section], &counts[section], &capacities[section], entry);
+			}
+		}
+		line = next;
+	}
+	free(text);
+	for(int i = 0; i < ps.define_count; i++)
+		free((char *) ps.defines[i].name);
+	free(ps.defines);
+
+	if(ps.errors)
+	{
+		fprintf(out, "%s: %d error%s\n", file_name, ps.errors, ps.errors > 1 ? "s" : "");
+		free(lists[0]);
+		free(lists[1]);
+		return ps.errors;
+	}
+	for(int i = 0; i < 2; i++)
+		if(lists[i] == NULL)
+			append_entry(&lists[i], &counts[i], &capacities[i], (struct micro_code){-1, 0, 0}), counts[i] = 0;
+	def->name = file_name;
+	def->list = lists[0];
+	def->jump = lists[1];
+	fprintf(out, "%s: %d micro code entries, %d jump template entries, %d defines\n", file_name, counts[0], counts[1], ps.define_count);
+	return 0;
+}
+
+void free_definition(struct microcode_def *def)
+{
+	free(def->list);
+	free(def->jump);
+}
+
+/*
+everything one build works on. nothing in the generator is global, so the batch mode can
+run one generator per variant on every core
+*/
+struct generator{
+	control_word store[EEPROM_SIZE];    //one control word per address, the chip images are derived from it
+	uint8_t written[EEPROM_SIZE/8]; //one bit per address, set once an entry has written that address
+	int conflicts;
+	int verbosity;                  //enum mc_log_level, what the passes report
+	const struct microcode_def *def; //tables being expanded, to name the first writer of a conflict
+	FILE *out;                      //reports, stdout or the build log of a batch variant
+	uint32_t check_seed;            //xorshift state of the compaction check
+};
+
+static void init_generator(struct generator *gen, FILE *out, int verbosity)
+{
+	memset(gen->written, 0, sizeof(gen->written));
+	gen->conflicts = 0;
+	gen->verbosity = verbosity;
+	gen->out = out;
+	gen->check_seed = 0x2545F491;
+}
+
+// report at level, dropped when the generator is quieter than that
+static void gen_log(const struct generator *gen, int level, const char *format, ...)
+{
+	va_list args;
+
+	if(level > gen->verbosity)
+		return;
+	va_start(args, format);
+	vfprintf(gen->out, format, args);
+	va_end(args);
+}
+
+// has an entry written this address
+static int step_written(const struct generator *gen, int addr)
+{
+	return (gen->written[addr>>3] >> (addr&7)) & 1;
+}
+
+static int entry_matches(const struct micro_code *entry, int32_t input, int addr)
+{
+	int32_t care = entry->care ? entry->care : CARE_DEFAULT;
+	return (addr & care) == (input & care);
+}
+
+/*
+the first entry expanded onto addr, in the order build_control_store and generate_interrupts expand them.
+a branch step has no entry: NULL with table "branch step" and its mode, NULL with table NULL when nothing writes addr
+*/
+static const struct micro_code *find_entry(const struct microcode_def *def, int addr, int interrupts, const char **table, int *index)
+{
+	for(int i = 0; def->list[i].input != -1; i++)
+		if(entry_matches(&def->list[i], def->list[i].input, addr))
+			return *table = "micro_code_list", *index = i, &def->list[i];
+	for(int i = 0; def->jump[i].input != -1; i++)
+		for(int k = 1; k < 8; k++)
+			if(entry_matches(&def->jump[i], def->jump[i].input + (k<<8), addr))
+				return *table = "jump_template", *index = i, &def->jump[i];
+	if((addr & 0xF0F0) == (JMP | S3) && (addr & 0x0700))
+		return *table = "branch step", *index = (addr >> 8) & 7, NULL;
+	for(int i = 0; interrupts && interrupt_list[i].input != -1; i++)
+		if(entry_matches(&interrupt_list[i], interrupt_list[i].input, addr))
+			return *table = "interrupt_list", *index = i, &interrupt_list[i];
+	*table = NULL;
+	*index = 0;
+	return NULL;
+}
+
+/*
+store one control word, two entries landing on the same address is a table bug (one of them silently lost),
+so it is reported with both entries and the run fails once the whole table has been checked.
+the written bitmap is the occupancy index, the first writer is only looked up again for a conflict
+*/
+static void set_word(struct generator *gen, int32_t addr, control_word word, const char *table, int index)
+{
+	if(gen->written[addr>>3] & (1 << (addr&7)))
+	{
+		const char *first_table;
+		int first_index;
+		find_entry(gen->def, addr, 1, &first_table, &first_index);
+		gen_log(gen, MC_LOG_ERROR, "conflict: %s entry %d writes address %04x which %s entry %d already wrote (old %0*llx new %0*llx)\n",
+			table, index, addr, first_table ? first_table : "a derived", first_index,
+			CONTROL_CHIPS * 2, (unsigned long long) gen->store[addr], CONTROL_CHIPS * 2, (unsigned long long) word);
+		gen->conflicts++;
+	}
+	gen->written[addr>>3] |= 1 << (addr&7);
+	gen->store[addr] = word;
+}
+
+/*
+rewrite an address the tables already wrote, for a pass that changes steps on purpose (the interrupt dispatch).
+the old word is released first, so a second write of the pass to the same address is still a conflict
+*/
+static void replace_word(struct generator *gen, int32_t addr, control_word word, const char *table, int index)
+{
+	gen->written[addr>>3] &= ~(1 << (addr&7));
+	set_word(gen, addr, word, table, index);
+}
+
+/*
+write word to every address that matches input on the care bits.
+the don't care bits below the lowest care bit form one contiguous run that is filled directly,
+the other don't care bits are walked as the subsets of their mask (x = (x - mask) & mask, a software pdep),
+so the cost is the number of addresses filled and not the nesting of loops over condition bits
+*/
+static void expand_entry(struct generator *gen, int32_t input, int32_t care, control_word word, const char *table, int index)
+{
+	uint32_t dont_care = ~(care ? care : CARE_DEFAULT) & 0xFFFF;
+	uint32_t run = ((dont_care + 1) & ~dont_care) - 1; //the low contiguous don't care bits, 0 if bit 0 is cared for
+	uint32_t spread = dont_care & ~run;
+	uint32_t base = input & ~dont_care;
+	uint32_t x = 0;
+
+	do
+	{
+		uint32_t first = base | x;
+		for(uint32_t addr = first; addr <= (first | run); addr++)
+		{
+			set_word(gen, addr, word, table, index);
+			if(gen->verbosity >= MC_LOG_TRACE)
+				fprintf(gen->out, "  %04x  %0*llx  %s[%d]\n", addr, CONTROL_CHIPS * 2, (unsigned long long) word, table, index);
+		}
+		x = (x - spread) & spread;
+	}while(x != 0);
+}
+
+/*
+fill the whole control store in a single pass over the tables.
+every address holds the full control word, the chip images are only byte planes of it
+*/
+static void build_control_store(struct generator *gen, const struct microcode_def *def)
+{
+	const struct micro_code *micro_code_list = def->list;
+	const struct micro_code *jump_template = def->jump;
+	int i = 0;
+
+	for(int addr = 0; addr < EEPROM_SIZE; addr++)
+		gen->store[addr] = FILL_WORD;
+	memset(gen->written, 0, sizeof(gen->written));
+	gen->conflicts = 0;
+	gen->def = def;
+
+	//unconditional
+	while(micro_code_list[i].input != -1)
+	{
+		expand_entry(gen, micro_code_list[i].input, micro_code_list[i].care, micro_code_list[i].output, "micro_code_list", i);
+		i++;
+	}
+
+	//conditional
+	gen_log(gen, MC_LOG_INFO, "generating micro code for conditional jump\n");
+	i=0;
+	while(jump_template[i].input != -1)
+	{
+		for(int k = 1 ; k < 8; k++)
+			expand_entry(gen, jump_template[i].input + (k<<8), jump_template[i].care, jump_template[i].output, "jump_template", i);
+		i++;
+	}
+
+	// for step 3 which is the branching step, taken when any flag selected by the opcode is set, I is don't care
+	for(int i = 1; i < 8 ; i++)
+	{
+		for(int j = 0; j < 8; j++)
+		{
+			if( (i&j) != 0 )
+				expand_entry(gen, JMP + S3 + (i<<8) + (j<<1), ~I & 0xFFFF, NS4 + LOAD_MAR0 + GATE_PC0, "branch step", i);
+			else
+				expand_entry(gen, JMP + S3 + (i<<8) + (j<<1), ~I & 0xFFFF, NS0, "branch step", i);
+		}
+	}
+}
+
+#define FETCH_SIGNALS (LOAD_MAR0 + GATE_PC0)
+#define PC1_FETCH_SIGNALS (LOAD_MAR1 + GATE_PC1)
+
+/*
+derive the FAST_FETCH form of one opcode (ir byte) and write it at its addresses with the FAST_FETCH mode bit set.
+
+every LOAD_MAR1 + GATE_PC1 step is dropped, its INCR_PC moves into the LOAD_MAR0 + GATE_PC0 step before it
+(pc0 is gated before the increment at the clock edge) and the remaining steps are renumbered from S0.
+the old step -> new step map has to be the same for every condition, so a conditional jump keeps one numbering for both outcomes.
+the fetch always becomes S0/S1, so the next opcode's first execute step is S2 in every fast form.
+a step that loads MAR1 from anything but the pc ends the dropping, the MAR1 reload after it is kept.
+an opcode whose sequence never returns to S0 gets the 2 step fetch, then reloads ir at S2 and runs its own steps from S3.
+the latch is low when S0 sees I, so the walk starts every condition from the plain fetch and not from the dispatch (-i).
+returns the steps saved by the longest path, 0 if only the fetch was rewritten, -1 if the opcode has no standard fetch,
+-2 (counted as a conflict) if it reads more byte through the pc than the latch checked
+*/
+static int derive_fast_fetch(struct generator *gen, int ir)
+{
+	const control_word *store = gen->store;
+	int8_t new_step[16];
+	struct { uint8_t step, cond, next; control_word word; } kept[256];
+	int kept_count = 0, used = 0, saved = 0, eligible = 1, span = 0;
+	int base = ir << 8, fast = base | FAST_FETCH;
+
+	control_word fetch0 = store[base | S0], fetch1 = store[base | S1], fetch2 = store[base | S2];
+	if(fetch0 != NS1 + FETCH_SIGNALS || fetch1 != NS2 + PC1_FETCH_SIGNALS + INCR_PC || fetch2 != NS3 + GATE_MEM + LOAD_IR)
+		return -1;
+
+	memset(new_step, -1, sizeof(new_step));
+	for(int cond = 0; cond < 16 && eligible; cond++)
+	{
+		int step = 0, visited = 0, length = 0, fast_length = 0, pc_reads = 0, mar1_moved = 0;
+		do
+		{
+			control_word word = step == 0 ? fetch0 : store[base | step << 4 | cond];
+			if(visited & (1 << step))
+			{
+				eligible = 0; //loops without going through S0
+				break;
+			}
+			visited |= 1 << step;
+			length++;
+			fast_length++;
+			if(new_step[step] < 0)
+				new_step[step] = used++;
+
+			int next = NEXT_STEP(word);
+			while(next != 0 && (store[base | next << 4 | cond] & ~(NS15|INCR_PC)) == PC1_FETCH_SIGNALS)
+			{
+				control_word dropped = store[base | next << 4 | cond];
+				if((word & (FETCH_SIGNALS|INCR_PC)) != FETCH_SIGNALS || (visited & (1 << next)) || mar1_moved)
+				{
+					eligible = 0;
+					break;
+				}
+				visited |= 1 << next;
+				length++;
+				word |= dropped & INCR_PC;
+				next = NEXT_STEP(dropped);
+			}
+			mar1_moved |= (word & LOAD_MAR1) != 0;
+			pc_reads += (word & INCR_PC) != 0;
+			kept[kept_count].step = step;
+			kept[kept_count].cond = cond;
+			kept[kept_count].next = next;
+			kept[kept_count].word = word & ~NS15;
+			kept_count++;
+			step = next;
+		}while(step != 0 && eligible);
+
+		if(length - fast_length > saved)
+			saved = length - fast_length;
+		if(pc_reads > span)
+			span = pc_reads;
+	}
+
+	//the renumbered fetch must line up across opcodes: old S2 (LOAD_IR) is new S1, old S3 is new S2
+	if(eligible && (new_step[0] != 0 || new_step[2] != 1 || (new_step[3] >= 0 && new_step[3] != 2)))
+		eligible = 0;
+	//the latch only checked that FAST_FETCH_SPAN byte stay in the page
+	if(eligible && span > FAST_FETCH_SPAN)
+	{
+		const char *name = opcode_name(ir);
+		gen_log(gen, MC_LOG_ERROR, "%s %02x reads %d byte through the pc, the FAST_FETCH latch only keeps %d in the page\n",
+			name ? name : "?", ir, span, FAST_FETCH_SPAN);
+		gen->conflicts++;
+		return -2;
+	}
+
+	if(!eligible)
+	{
+		for(int cond = 0; cond < 16; cond++)
+		{
+			set_word(gen, fast | S0 | cond, NS1 + FETCH_SIGNALS + INCR_PC, "fast fetch", ir);
+			set_word(gen, fast | S1 | cond, NS2 + GATE_MEM + LOAD_IR, "fast fetch", ir);
+			for(int step = 2; step < 16; step++) //S2 reloads ir from the same address, then continue at S3
+				if(step_written(gen, base | step << 4 | cond))
+					set_word(gen, fast | step << 4 | cond, store[base | step << 4 | cond], "fast fetch", ir);
+		}
+		return 0;
+	}
+
+	for(int i = 0; i < kept_count; i++)
+	{
+		control_word word = kept[i].word | FIELD(STEP0, kept[i].next ? new_step[kept[i].next] : 0);
+		set_word(gen, fast | new_step[kept[i].step] << 4 | kept[i].cond, word, "fast fetch", ir);
+	}
+	return saved;
+}
+
+/*
+fast form of every opcode that has a fetch, with a report of the saved steps.
+an opcode outside the jump group that already uses the FAST_FETCH mode bit would be read as the fast form of its twin,
+that, a fast form landing on a written address and one longer than FAST_FETCH_SPAN count as conflicts
+*/
+static void generate_fast_fetch(struct generator *gen)
+{
+	gen_log(gen, MC_LOG_INFO, "generating FAST_FETCH forms\n");
+	for(int ir = 0; ir < 256; ir++)
+	{
+		const char *name = opcode_name(ir);
+		if(!FAST_FETCH_ROUTED(ir) || !(ir << 8 & FAST_FETCH) || !step_written(gen, ir << 8))
+			continue;
+		gen_log(gen, MC_LOG_ERROR, "%s %02x uses mode bit ir1, which FAST_FETCH drives outside the jump group\n", name ? name : "?", ir);
+		gen->conflicts++;
+	}
+	if(gen->conflicts)
+		return;
+
+	for(int ir = 0; ir < 256; ir++)
+	{
+		if(!step_written(gen, ir << 8)) //S0 of this opcode never written
+			continue;
+		const char *name = opcode_name(ir);
+		if(!FAST_FETCH_ROUTED(ir))
+		{
+			gen_log(gen, MC_LOG_DEBUG, "  %-10s %02x  jump group, the latch does not reach ir1\n", name ? name : "?", ir);
+			continue;
+		}
+		if(ir << 8 & FAST_FETCH) //the fast form just written
+			continue;
+		int saved = derive_fast_fetch(gen, ir);
+		if(saved == -1)
+			gen_log(gen, MC_LOG_DEBUG, "  %-10s %02x  no standard fetch, left alone\n", name ? name : "?", ir);
+		else if(saved == 0)
+			gen_log(gen, MC_LOG_DEBUG, "  %-10s %02x  fetch only, its own steps kept\n", name ? name : "?", ir);
+		else if(saved > 0)
+			gen_log(gen, MC_LOG_DEBUG, "  %-10s %02x  %d step%s saved\n", name ? name : "?", ir, saved, saved > 1 ? "s" : "");
+	}
+}
+
+/*
+interrupt dispatch at every instruction boundary: the entry and RTI from interrupt_list go through the conflict check,
+then S0 of every opcode with I set becomes the dispatch and a halt step (a step looping onto itself, STP) with I set
+goes back to S0, so STP waits for the interrupt. returns the number of conflicts
+*/
+static int generate_interrupts(struct generator *gen)
+{
+	int before = gen->conflicts, opcodes = 0;
+
+	gen_log(gen, MC_LOG_INFO, "generating interrupt dispatch\n");
+	for(int i = 0; interrupt_list[i].input != -1; i++)
+		expand_entry(gen, interrupt_list[i].input, interrupt_list[i].care, interrupt_list[i].output, "interrupt_list", i);
+	if(gen->conflicts != before)
+		return gen->conflicts - before;
+
+	for(int ir = 0; ir < 256; ir++)
+	{
+		int base = ir << 8;
+		if(!step_written(gen, base))
+			continue;
+		opcodes++;
+		for(int cond = I; cond < 16; cond += 2) //every condition value with I set
+		{
+			replace_word(gen, base | S0 | cond, INT_DISPATCH, "interrupt dispatch", ir);
+			for(int step = 1; step < 16; step++)
+			{
+				int addr = base | step << 4 | cond;
+				if(step_written(gen, addr) && gen->store[addr] == FIELD(STEP0, step))
+					replace_word(gen, addr, NS0, "interrupt dispatch", ir);
+			}
+		}
+	}
+	gen_log(gen, MC_LOG_INFO, "  dispatch in S0 of %d opcodes, entry at opcode 00 S%d, RTI at %02x\n", opcodes, INT_ENTRY >> 4, IR_OF(RTI));
+	return 0;
+}
+
+// "S5 S6 S7" for a set of steps
+static void format_steps(char *text, unsigned set)
+{
+	*text = 0;
+	for(int step = 0; step < 16; step++)
+		if(set >> step & 1)
+			text += sprintf(text, " S%d", step);
+}
+
+/*
+walk the next step graph of every opcode, a step's successors are the NS of all its written condition values.
+a fetch (LOAD_IR) can start any opcode at its NS, so those steps and S0 are where an opcode is entered, and a step
+that loads IR leaves the opcode. a step looping onto itself with no signal is a halt (STP) and counts as leaving.
+reported as warnings, the image is still written: written steps nothing reaches, a step going to a step no entry
+writes (the filler there goes back to S0 with no signal) and steps that never get to a fetch again.
+returns the number of opcodes with a finding
+*/
+static int check_step_graph(struct generator *gen)
+{
+	const control_word *store = gen->store;
+	unsigned entered = 1u << 0;
+	int opcodes = 0, flagged = 0;
+	char steps[64];
+
+	for(int addr = 0; addr < EEPROM_SIZE; addr++)
+		if((store[addr] & LOAD_IR) && step_written(gen, addr))
+			entered |= 1u << NEXT_STEP(store[addr]);
+
+	for(int ir = 0; ir < 256; ir++)
+	{
+		unsigned written = 0, leaves = 0, next[16] = {0};
+		for(int step = 0; step < 16; step++)
+			for(int cond = 0; cond < 16; cond++)
+			{
+				int addr = ir << 8 | step << 4 | cond;
+				if(!step_written(gen, addr))
+					continue;
+				written |= 1u << step;
+				if((store[addr] & LOAD_IR) || store[addr] == FIELD(STEP0, step))
+					leaves |= 1u << step;
+				else
+					next[step] |= 1u << NEXT_STEP(store[addr]);
+			}
+		if(!written)
+			continue;
+		opcodes++;
+
+		unsigned reached = entered & written, before;
+		do
+		{
+			before = reached;
+			for(int step = 0; step < 16; step++)
+				if(reached >> step & 1)
+					reached |= next[step] & written;
+		}while(reached != before);
+
+		unsigned returns = leaves; //steps that get to a fetch, through the filler too
+		do
+		{
+			before = returns;
+			for(int step = 0; step < 16; step++)
+				if(next[step] & (returns | ~written))
+					returns |= 1u << step;
+		}while(returns != before);
+
+		const char *name = opcode_name(ir);
+		int found = 0;
+		if(written & ~reached)
+		{
+			format_steps(steps, written & ~reached);
+			gen_log(gen, MC_LOG_WARN, "step graph: %-10s %02x %s never reached\n", name ? name : "?", ir, steps);
+			found = 1;
+		}
+		for(int step = 0; step < 16; step++)
+			if((reached >> step & 1) && (next[step] & ~written))
+			{
+				format_steps(steps, next[step] & ~written);
+				gen_log(gen, MC_LOG_WARN, "step graph: %-10s %02x  S%d goes to%s, which no entry writes\n", name ? name : "?", ir, step, steps);
+				found = 1;
+			}
+		unsigned stuck = reached & ~returns;
+		if(stuck)
+		{
+			format_steps(steps, stuck);
+			gen_log(gen, MC_LOG_WARN, "step graph: %-10s %02x %s never get%s back to a fetch\n", name ? name : "?", ir, steps,
+				(stuck & (stuck - 1)) == 0 ? "s" : "");
+			found = 1;
+		}
+		flagged += found;
+	}
+	gen_log(gen, MC_LOG_INFO, "checked the next step graph of %d opcodes, %d with a finding\n", opcodes, flagged);
+	return flagged;
+}
+
+// de-interleave the control store into one byte plane per chip, chip 0 holds the lowest 8 control bits
+static void split_planes(const control_word *store, uint8_t planes[][EEPROM_SIZE])
+{
+	for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+	{
+		uint8_t *restrict plane = planes[chip];
+		int shift = 8 * chip;
+
+		//straight line loop with no dependency between addresses, the compiler vectorize this
+		for(int addr = 0; addr < EEPROM_SIZE; addr++)
+			plane[addr] = (uint8_t) (store[addr] >> shift);
+	}
+}
+
+/*
+library interface, see microcode.h. a control store is one arena allocation for its words, occupancy and chip
+planes, the spans handed out point straight into it
+*/
+struct control_store{
+	control_word *words;
+	const uint8_t *written;         //NULL for loaded images
+	uint8_t (*planes)[EEPROM_SIZE]; //CONTROL_CHIPS byte planes of words
+};
+
+static size_t read_file(const char *file_name, void *data, size_t size)
+{
+	FILE * fPtr = fopen(file_name, "rb");
+	if(fPtr == NULL)
+	{
+		printf("Unable to open file %s.\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	size_t got = fread(data, 1, size, fPtr);
+	if(ferror(fPtr))
+	{
+		printf("oh no, the read failed for %s!!!\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	fclose(fPtr);
+	return got;
+}
+
+// write a buffer to a file in one call, any failure is fatal
+void write_file(const char *file_name, const void *data, size_t size)
+{
+	FILE * fPtr = fopen(file_name, "wb");
+	if(fPtr == NULL)
+	{
+		/* File not created hence exit */
+		printf("Unable to create file %s.\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	if(fwrite(data, 1, size, fPtr) != size || fclose(fPtr) != 0)
+	{
+		printf("oh no, the write failed for %s!!!\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+incremental programming: compare the new image with the chip file already on disk page by page,
+write chipN.patch with only the pages that changed and patch those pages into chipN.bin in place.
+the patch file is complete on disk before the first page of chipN.bin changes, a failed write leaves the old image
+
+patch file layout (little endian): "MCPATCH1", uint16 page size, uint16 page count,
+then per page a uint16 start address followed by the page content
+the patched file is read back and compared with the image, returns non zero after reporting a mismatch
+*/
+int write_incremental(const char *file_name, const char *patch_name, const uint8_t *image)
+{
+	static uint8_t patch[16 + (EEPROM_SIZE / MC_PAGE_SIZE) * (2 + MC_PAGE_SIZE)];
+	struct stat st;
+	uint8_t *old = NULL;
+	int pages = 0;
+
+	int fd = open(file_name, O_RDWR);
+	if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size == EEPROM_SIZE)
+	{
+		old = mmap(NULL, EEPROM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(old == MAP_FAILED)
+			old = NULL;
+	}
+
+	memcpy(patch, "MCPATCH1", 8);
+	size_t length = 12;
+	for(int addr = 0; addr < EEPROM_SIZE; addr += MC_PAGE_SIZE)
+	{
+		if(old && memcmp(old + addr, image + addr, MC_PAGE_SIZE) == 0)
+			continue;
+		patch[length] = addr & 0xFF;
+		patch[length+1] = addr >> 8;
+		memcpy(patch + length + 2, image + addr, MC_PAGE_SIZE);
+		length += 2 + MC_PAGE_SIZE;
+		pages++;
+	}
+	patch[8] = MC_PAGE_SIZE & 0xFF;
+	patch[9] = MC_PAGE_SIZE >> 8;
+	patch[10] = pages & 0xFF;
+	patch[11] = pages >> 8;
+	write_file(patch_name, patch, length);
+
+	if(old)
+	{
+		for(int i = 0; i < pages; i++)
+		{
+			const uint8_t *entry = patch + 12 + i * (2 + MC_PAGE_SIZE);
+			memcpy(old + (entry[0] | entry[1] << 8), entry + 2, MC_PAGE_SIZE);
+		}
+		int synced = msync(old, EEPROM_SIZE, MS_SYNC) == 0;
+		munmap(old, EEPROM_SIZE);
+		if(!synced)
+		{
+			printf("oh no, the write failed for %s!!!\n", file_name);
+			close(fd);
+			return 1;
+		}
+	}
+	if(fd >= 0)
+		close(fd);
+	if(!old) //nothing usable to patch, every page is new
+		write_file(file_name, image, EEPROM_SIZE);
+
+	printf("%s: %d of %d pages changed%s", file_name, pages, EEPROM_SIZE / MC_PAGE_SIZE, pages ? ":" : "\n");
+	for(int i = 0; i < pages; i++)
+	{
+		const uint8_t *entry = patch + 12 + i * (2 + MC_PAGE_SIZE);
+		if(i == 16)
+		{
+			printf(" ... (%d more)\n", pages - 16);
+			break;
+		}
+		printf(" %04x%s", entry[0] | entry[1] << 8, i == pages - 1 ? "\n" : "");
+	}
+
+	static uint8_t check[EEPROM_SIZE];
+	if(read_file(file_name, check, sizeof(check)) != EEPROM_SIZE || memcmp(check, image, EEPROM_SIZE) != 0)
+	{
+		printf("%s does not read back as the new image!!!\n", file_name);
+		return 1;
+	}
+	return 0;
+}
+
+/*
+write the chip images as C arrays so a simulator or programmer can compile them in
+instead of reading chipN.bin at runtime
+*/
+void write_rom_header(const char *file_name, const struct control_store *cs)
+{
+	FILE * fPtr = fopen(file_name, "w");
+	if(fPtr == NULL)
+	{
+		printf("Unable to create file %s.\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	setvbuf(fPtr, NULL, _IOFBF, 1 << 20);
+	fprintf(fPtr, "/* generated by microcode_generator, do not edit */\n");
+	fprintf(fPtr, "#ifndef MICROCODE_ROM_H\n#define MICROCODE_ROM_H\n\n#include <stdint.h>\n\n");
+	for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+	{
+		fprintf(fPtr, "static const uint8_t chip%d_rom[%d] = {\n", chip, EEPROM_SIZE);
+		for(int addr = 0; addr < EEPROM_SIZE; addr++)
+			fprintf(fPtr, "0x%02x,%s", cs->planes[chip][addr], (addr & 15) == 15 ? "\n" : "");
+		fprintf(fPtr, "};\n\n");
+	}
+	fprintf(fPtr, "#endif\n");
+	if(ferror(fPtr) || fclose(fPtr) != 0)
+	{
+		printf("oh no, the write failed for %s!!!\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+}
+
+// read a whole file into a buffer, returns the number of byte read, any failure is fatal
+// rebuild the control store from chip0.bin..chipN.bin, the inverse of split_planes
+static void load_control_store(control_word *store, uint8_t planes[][EEPROM_SIZE])
+{
+	for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+	{
+		char file_name[20]="chip .bin";
+		file_name[4]=(char)chip+0x30;
+		if(read_file(file_name, planes[chip], EEPROM_SIZE) != EEPROM_SIZE)
+		{
+			printf("%s is not a %d byte image\n", file_name, EEPROM_SIZE);
+			exit(EXIT_FAILURE);
+		}
+	}
+	for(int addr = 0; addr < EEPROM_SIZE; addr++)
+	{
+		store[addr] = 0;
+		for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+			store[addr] |= (control_word) planes[chip][addr] << (8 * chip);
+	}
+}
+
+/*
+compressed images for the serial programmer, the format is described in mcz_decode.h.
+
+most rows of 16 condition addresses hold one byte 16 times and most of the image is filler, so an image
+shrinks to a few hundred byte. the encoder is streaming: rows are fed one at a time and a token is written
+as soon as the next MCZ_MAX_RUN rows are known, copies look back through a hash chain of the rows before
+*/
+#define MCZ_ROWS (EEPROM_SIZE / MCZ_ROW)
+#define MCZ_HASH 1024
+#define MCZ_CHAIN 16 //earlier rows tried per copy
+#define UART_BAUD 9600
+
+struct mcz_encoder{
+	FILE *out;
+	uint8_t rows[MCZ_ROWS][MCZ_ROW]; //every row fed so far
+	int fed;                         //rows fed
+	int done;                        //rows encoded, fed - done wait for a decision
+	int16_t head[MCZ_HASH];          //last encoded row of each hash, -1 when none
+	int16_t chain[MCZ_ROWS];         //the encoded row before with the same hash
+	uint8_t buffer[256];
+	size_t used;
+	size_t bytes;                    //total written
+};
+
+static unsigned mcz_hash(const uint8_t *row)
+{
+	uint32_t h = 2166136261u;
+	for(int i = 0; i < MCZ_ROW; i++)
+		h = (h ^ row[i]) * 16777619u;
+	return h % MCZ_HASH;
+}
+
+static int mcz_uniform(const uint8_t *row)
+{
+	return memcmp(row, row + 1, MCZ_ROW - 1) == 0;
+}
+
+static void mcz_flush(struct mcz_encoder *enc)
+{
+	if(fwrite(enc->buffer, 1, enc->used, enc->out) != enc->used)
+	{
+		printf("oh no, the write failed for the compressed image!!!\n");
+		exit(EXIT_FAILURE);
+	}
+	enc->bytes += enc->used;
+	enc->used = 0;
+}
+
+static void mcz_byte(struct mcz_encoder *enc, uint8_t b)
+{
+	if(enc->used == sizeof(enc->buffer))
+		mcz_flush(enc);
+	enc->buffer[enc->used++] = b;
+}
+
+// longest copy for the row at, from a row already encoded
+static int mcz_match(const struct mcz_encoder *enc, int at, int avail, int *from)
+{
+	int best = 0;
+	int tries = MCZ_CHAIN;
+	for(int c = enc->head[mcz_hash(enc->rows[at])]; c >= 0 && tries--; c = enc->chain[c])
+	{
+		int length = 0;
+		while(length < avail && memcmp(enc->rows[c + length], enc->rows[at + length], MCZ_ROW) == 0)
+			length++;
+		if(length > best)
+		{
+			best = length;
+			*from = c;
+		}
+	}
+	return best;
+}
+
+// same uniform row repeated from at
+static int mcz_fill(const struct mcz_encoder *enc, int at, int avail)
+{
+	int length = 0;
+	if(!mcz_uniform(enc->rows[at]))
+		return 0;
+	while(length < avail && memcmp(enc->rows[at + length], enc->rows[at], MCZ_ROW) == 0)
+		length++;
+	return length;
+}
+
+static void mcz_token(struct mcz_encoder *enc)
+{
+	int at = enc->done;
+	int avail = enc->fed - at < MCZ_MAX_RUN ? enc->fed - at : MCZ_MAX_RUN;
+	int from = 0;
+	int fill = mcz_fill(enc, at, avail);
+	int copy = mcz_match(enc, at, avail, &from);
+	int uniform = mcz_uniform(enc->rows[at]);
+	int n;
+
+	//cost per token: fill 2 byte, copy 3, uniform 1 + 1 per row, literal 1 + 16 per row
+	if(fill >= 2 && fill >= copy)
+	{
+		n = fill;
+		mcz_byte(enc, MCZ_FILL | (n - 1));
+		mcz_byte(enc, enc->rows[at][0]);
+	}
+	else if(copy >= 3 || (copy && !uniform))
+	{
+		n = copy;
+		mcz_byte(enc, MCZ_COPY | (n - 1));
+		mcz_byte(enc, from & 0xFF);
+		mcz_byte(enc, from >> 8);
+	}
+	else
+	{
+		//run of rows no other token does better on, stop where one would
+		n = 1;
+		while(n < avail && mcz_uniform(enc->rows[at + n]) == uniform)
+		{
+			int rest = avail - n;
+			int f = mcz_fill(enc, at + n, rest);
+			int c = mcz_match(enc, at + n, rest, &from);
+			if(f >= 2 || c >= 3 || (c && !uniform))
+				break;
+			n++;
+		}
+		mcz_byte(enc, (uniform ? MCZ_UNIFORM : MCZ_LITERAL) | (n - 1));
+		for(int i = 0; i < n; i++)
+		{
+			if(uniform)
+				mcz_byte(enc, enc->rows[at + i][0]);
+			else
+				for(int j = 0; j < MCZ_ROW; j++)
+					mcz_byte(enc, enc->rows[at + i][j]);
+		}
+	}
+
+	for(int i = 0; i < n; i++, enc->done++)
+	{
+		unsigned h = mcz_hash(enc->rows[enc->done]);
+		enc->chain[enc->done] = enc->head[h];
+		enc->head[h] = (int16_t) enc->done;
+	}
+}
+
+static void mcz_begin(struct mcz_encoder *enc, FILE *out)
+{
+	enc->out = out;
+	enc->fed = enc->done = 0;
+	enc->used = enc->bytes = 0;
+	memset(enc->head, 0xFF, sizeof(enc->head));
+	for(int i = 0; i < 4; i++)
+		mcz_byte(enc, (uint8_t) "MCZ1"[i]);
+	mcz_byte(enc, MCZ_ROWS & 0xFF);
+	mcz_byte(enc, MCZ_ROWS >> 8);
+}
+
+static void mcz_put_row(struct mcz_encoder *enc, const uint8_t *row)
+{
+	memcpy(enc->rows[enc->fed++], row, MCZ_ROW);
+	if(enc->fed - enc->done == MCZ_MAX_RUN)
+		mcz_token(enc);
+}
+
+static size_t mcz_end(struct mcz_encoder *enc)
+{
+	while(enc->done < enc->fed)
+		mcz_token(enc);
+	mcz_flush(enc);
+	return enc->bytes;
+}
+
+// the reference decoder reading a file back into a buffer, the eeprom stand in
+struct mcz_check{
+	const uint8_t *data;
+	size_t size, at;
+	uint8_t image[EEPROM_SIZE];
+};
+
+static int check_read_byte(void *ctx)
+{
+	struct mcz_check *check = ctx;
+	return check->at < check->size ? check->data[check->at++] : -1;
+}
+
+static void check_write_row(void *ctx, uint16_t row, const uint8_t *data)
+{
+	memcpy(((struct mcz_check *) ctx)->image + row * MCZ_ROW, data, MCZ_ROW);
+}
+
+static void check_read_row(void *ctx, uint16_t row, uint8_t *data)
+{
+	memcpy(data, ((struct mcz_check *) ctx)->image + row * MCZ_ROW, MCZ_ROW);
+}
+
+// write chipN.mcz for every chip, decode each back to check it and report the ratio and the upload time
+int write_compressed(const struct control_store *cs)
+{
+	static struct mcz_encoder enc;
+	static struct mcz_check check;
+	static uint8_t data[EEPROM_SIZE * 2];
+	const struct mcz_io io = {check_read_byte, check_write_row, check_read_row, &check};
+	size_t total = 0;
+	int failed = 0;
+
+	for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+	{
+		char file_name[20]="chip .mcz";
+		file_name[4]=(char)chip+0x30;
+		FILE * fPtr = fopen(file_name, "wb");
+		if(fPtr == NULL)
+		{
+			printf("Unable to create file %s.\n", file_name);
+			exit(EXIT_FAILURE);
+		}
+		mcz_begin(&enc, fPtr);
+		for(int addr = 0; addr < EEPROM_SIZE; addr += MCZ_ROW)
+			mcz_put_row(&enc, cs->planes[chip] + addr);
+		size_t size = mcz_end(&enc);
+		if(fclose(fPtr) != 0)
+		{
+			printf("oh no, the write failed for %s!!!\n", file_name);
+			exit(EXIT_FAILURE);
+		}
+
+		check.data = data;
+		check.size = read_file(file_name, data, sizeof(data));
+		check.at = 0;
+		if(mcz_decode(&io) != MCZ_ROWS || check.at != check.size || memcmp(check.image, cs->planes[chip], EEPROM_SIZE) != 0)
+		{
+			printf("%s does not decode back to the image!!!\n", file_name);
+			failed = 1;
+		}
+		printf("%s: %zu byte, %.1f:1\n", file_name, size, (double) EEPROM_SIZE / size);
+		total += size;
+	}
+	//8N1, ten bits on the wire per byte
+	printf("upload at %d baud: %.1f s for the raw images, %.2f s compressed\n", UART_BAUD,
+		(double) CONTROL_CHIPS * EEPROM_SIZE * 10 / UART_BAUD, (double) total * 10 / UART_BAUD);
+	return failed;
+}
+
+/*
+address bit pruning.
+
+an address bit matters when flipping it changes the control word somewhere. a bit that never does can be left
+unconnected and the control store folds into a part half the size, the remaining cpu address bits are wired
+to the rom address lines in order (the remap table). smaller eeproms are also the faster ones
+*/
+static const char *address_bit_names[16] = {
+	"I", "C", "N", "Z", "step0", "step1", "step2", "step3",
+	"ir0 (mode)", "ir1 (mode/FAST_FETCH)", "ir2 (mode)", "ir3 (mode)", "ir4 (opcode)", "ir5 (opcode)", "ir6 (opcode)", "ir7 (opcode)",
+};
+
+//eeprom sizes the folded image is offered for
+static const struct { int size; const char *part; } eeprom_parts[] = {
+	{2048, "28C16"}, {8192, "28C64"}, {32768, "28C256"}, {65536, "28C512"},
+};
+
+/*
+address bits (of the 16 below bit 16, only the ones inside [from, to) can flip) that change the control word
+for some address in [from, to). with a written bitmap the unwritten addresses are don't care.
+pairs[bit] counts the address pairs that differ
+*/
+static unsigned relevant_bits(const control_word *store, const uint8_t *written, int from, int to, unsigned pairs[16])
+{
+	unsigned mask = 0;
+
+	memset(pairs, 0, 16 * sizeof(unsigned));
+	for(int addr = from; addr < to; addr++)
+	{
+		if(written && !(written[addr>>3] & (1 << (addr&7))))
+			continue;
+		for(int bit = 0; bit < 16; bit++)
+		{
+			int other = addr | 1 << bit;
+			if((addr & 1 << bit) || other >= to)
+				continue;
+			if(written && !(written[other>>3] & (1 << (other&7))))
+				continue;
+			if(store[addr] != store[other])
+			{
+				pairs[bit]++;
+				mask |= 1 << bit;
+			}
+		}
+	}
+	return mask;
+}
+
+static int count_bits(unsigned mask)
+{
+	int n = 0;
+	for(; mask; mask &= mask - 1)
+		n++;
+	return n;
+}
+
+// the bits of mask from bit top down, one character each, '.' for a bit that never matters
+static void print_bit_mask(unsigned mask, int top)
+{
+	static const char field[16] = "ICNZssssmmmmoooo";
+	for(int bit = top; bit >= 0; bit--)
+		putchar(mask & 1 << bit ? field[bit] : '.');
+}
+
+// report which address bits matter, globally and in each opcode range, returns the global mask
+static unsigned analyse_address_bits(const control_word *store, const uint8_t *written)
+{
+	unsigned pairs[16], unused[16];
+	unsigned mask = relevant_bits(store, NULL, 0, EEPROM_SIZE, pairs);
+
+	printf("address bits that change the control word (differing address pairs)\n");
+	for(int bit = 15; bit >= 0; bit--)
+		printf("  bit %2d %-21s %6u%s\n", bit, address_bit_names[bit], pairs[bit], mask & 1 << bit ? "" : "  never matters");
+	if(written)
+	{
+		unsigned loose = relevant_bits(store, written, 0, EEPROM_SIZE, unused);
+		if(loose != mask)
+		{
+			printf("  with the unused addresses as don't care only %d bits matter: ", count_bits(loose));
+			print_bit_mask(loose, 15);
+			printf("\n  (folding those out would let an undefined opcode or step alias a used one)\n");
+		}
+	}
+
+	printf("per opcode range (bits 11-0, o=opcode m=mode s=step, I C N Z=condition)\n");
+	for(int range = 0; range < 16; range++)
+	{
+		unsigned local = relevant_bits(store, NULL, range << 12, (range + 1) << 12, unused);
+		printf("  %x000-%xfff  ", range, range);
+		print_bit_mask(local, 11);
+		printf("  %d bit%s\n", count_bits(local), count_bits(local) == 1 ? "" : "s");
+	}
+	return mask;
+}
+
+/*
+fold the control store into a part of size byte keeping the address bits of keep, lowest rom line first.
+a part bigger than 1 << bits repeats the image, so the spare address lines can be tied either way.
+writes chipN_folded.bin and folded_remap.txt, returns 0 when keep does not fit
+*/
+static int write_folded(const control_word *store, unsigned keep, int size, const char *part)
+{
+	static uint8_t planes[CONTROL_CHIPS][EEPROM_SIZE];
+	int lines = count_bits(keep);
+
+	if((1 << lines) > size)
+		return 0;
+
+	//walk the kept bits as a counter (pdep of the rom address onto keep)
+	uint32_t addr = 0;
+	for(int rom = 0; rom < (1 << lines); rom++)
+	{
+		for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+			planes[chip][rom] = (uint8_t) (store[addr] >> (8 * chip));
+		addr = (addr - keep) & keep;
+	}
+	for(int rom = 1 << lines; rom < size; rom++)
+		for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+			planes[chip][rom] = planes[chip][rom & ((1 << lines) - 1)];
+
+	for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+	{
+		char file_name[32];
+		snprintf(file_name, sizeof(file_name), "chip%d_folded.bin", chip);
+		write_file(file_name, planes[chip], size);
+	}
+
+	FILE * fPtr = fopen("folded_remap.txt", "w");
+	if(fPtr == NULL)
+	{
+		printf("Unable to create file folded_remap.txt.\n");
+		exit(EXIT_FAILURE);
+	}
+	fprintf(fPtr, "# folded control store for %d byte %s parts, %d of the 16 address bits used\n", size, part, lines);
+	fprintf(fPtr, "# rom line <- cpu address bit\n");
+	int rom = 0;
+	for(int bit = 0; bit < 16; bit++)
+		if(keep & 1 << bit)
+			fprintf(fPtr, "A%-2d <- bit %2d  %s\n", rom++, bit, address_bit_names[bit]);
+	for(; (1 << rom) < size; rom++)
+		fprintf(fPtr, "A%-2d <- tie to 0 or 1\n", rom);
+	for(int bit = 0; bit < 16; bit++)
+		if(!(keep & 1 << bit))
+			fprintf(fPtr, "# bit %2d %s not connected, it never changes the control word\n", bit, address_bit_names[bit]);
+	if(ferror(fPtr) || fclose(fPtr) != 0)
+	{
+		printf("oh no, the write failed for folded_remap.txt!!!\n");
+		exit(EXIT_FAILURE);
+	}
+	return 1;
+}
+
+// analysis plus the folded image for the requested size, 0 picks the smallest part the image fits in
+int fold_control_store(const control_word *store, const uint8_t *written, int size)
+{
+	unsigned keep = analyse_address_bits(store, written);
+	int lines = count_bits(keep);
+	int parts = sizeof(eeprom_parts) / sizeof(eeprom_parts[0]);
+
+	for(int i = 0; i < parts; i++)
+	{
+		if(size ? eeprom_parts[i].size != size : eeprom_parts[i].size < (1 << lines))
+			continue;
+		if(!write_folded(store, keep, eeprom_parts[i].size, eeprom_parts[i].part))
+			break;
+		printf("folded into %d byte %s parts (%d address lines): chip0_folded.bin..chip%d_folded.bin, folded_remap.txt\n",
+			eeprom_parts[i].size, eeprom_parts[i].part, lines, CONTROL_CHIPS - 1);
+		return 0;
+	}
+	if(size)
+		printf("the control store needs %d address lines (%d byte), it does not fold into %d byte\n", lines, 1 << lines, size);
+	else
+		printf("no part in the list fits %d address lines\n", lines);
+	return 1;
+}
+
+/*
+two level logic minimization: a sum of products for every control bit, for a PLA/GAL/CPLD instead of the eeproms.
+
+the on set of a bit is the written addresses where it is 1, the off set the written addresses where it is 0,
+every unwritten address is don't care. the loop is the one of espresso: expand every cube as far as the off set
+allows (raising first the literal that covers most of what is still uncovered), drop the cubes the others cover,
+then reduce each cube to what only it covers and expand again, until the cover stops getting cheaper
+*/
+#define SIGNAL_NAME(name, at) [at] = #name,
+static const char *control_bit_names[CONTROL_BITS] = { SIGNAL_TABLE(SIGNAL_NAME) }; //NULL for a pin no signal drives
+#undef SIGNAL_NAME
+
+//address bits as pla inputs, lowest first
+static const char *pla_input_names[16] = {
+	"I", "C", "N", "Z", "ST0", "ST1", "ST2", "ST3", "IR0", "IR1", "IR2", "IR3", "IR4", "IR5", "IR6", "IR7",
+};
+
+//product term: the address bits of mask must equal the bits of value, the other bits are free
+struct cube{
+	uint16_t value;
+	uint16_t mask;
+};
+
+struct cover{
+	struct cube *cubes;
+	int count;
+	int capacity;
+};
+
+#define IN_CUBE(point, cube) (((point) & (cube).mask) == (cube).value)
+
+static int cube_hits(struct cube cube, const uint16_t *points, int count)
+{
+	for(int i = 0; i < count; i++)
+		if(IN_CUBE(points[i], cube))
+			return 1;
+	return 0;
+}
+
+// raise literals of cube while it stays clear of the off set, the one that covers most uncovered on points first
+static struct cube expand_cube(struct cube cube, const uint16_t *on, const uint8_t *covered, int on_count,
+	const uint16_t *off, int off_count)
+{
+	for(;;)
+	{
+		struct cube best = cube;
+		int best_gain = -1;
+		for(unsigned rest = cube.mask; rest; rest &= rest - 1)
+		{
+			unsigned bit = rest & -rest;
+			struct cube wider = {cube.value & ~bit, cube.mask & ~bit};
+			struct cube flipped = {cube.value ^ bit, cube.mask}; //the half wider adds, the only part that can hit the off set
+			if(cube_hits(flipped, off, off_count))
+				continue;
+			int gain = 0;
+			for(int i = 0; i < on_count; i++)
+				gain += !covered[i] && IN_CUBE(on[i], wider);
+			if(gain > best_gain)
+			{
+				best_gain = gain;
+				best = wider;
+			}
+		}
+		if(best_gain < 0)
+			return cube;
+		cube = best;
+	}
+}
+
+static void add_cube(struct cover *cover, struct cube cube)
+{
+	if(cover->count == cover->capacity)
+	{
+		cover->capacity = cover->capacity ? cover->capacity * 2 : 64;
+		cover->cubes = realloc(cover->cubes, cover->capacity * sizeof(struct cube));
+		if(cover->cubes == NULL)
+		{
+			printf("out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	cover->cubes[cover->count++] = cube;
+}
+
+// times every on point is covered
+static void count_coverage(const struct cover *cover, const uint16_t *on, int on_count, uint8_t *times)
+{
+	memset(times, 0, on_count);
+	for(int c = 0; c < cover->count; c++)
+		for(int i = 0; i < on_count; i++)
+			if(IN_CUBE(on[i], cover->cubes[c]) && times[i] < 255)
+				times[i]++;
+}
+
+// drop every cube whose on points are all covered by the other cubes, the biggest cubes are kept first
+static void make_irredundant(struct cover *cover, const uint16_t *on, int on_count, uint8_t *times)
+{
+	count_coverage(cover, on, on_count, times);
+	for(int c = cover->count - 1; c >= 0; c--)
+	{
+		int needed = 0;
+		for(int i = 0; i < on_count && !needed; i++)
+			needed = IN_CUBE(on[i], cover->cubes[c]) && times[i] == 1;
+		if(needed)
+			continue;
+		for(int i = 0; i < on_count; i++)
+			if(IN_CUBE(on[i], cover->cubes[c]))
+				times[i]--;
+		cover->cubes[c] = cover->cubes[--cover->count];
+	}
+}
+
+static int cover_literals(const struct cover *cover)
+{
+	int literals = 0;
+	for(int c = 0; c < cover->count; c++)
+		literals += count_bits(cover->cubes[c].mask);
+	return literals;
+}
+
+static int by_cube_size(const void *x, const void *y)
+{
+	return count_bits(((const struct cube *) x)->mask) - count_bits(((const struct cube *) y)->mask);
+}
+
+// minimized cover of one control bit
+static void minimize_bit(const uint16_t *on, int on_count, const uint16_t *off, int off_count, struct cover *cover)
+{
+	uint8_t *covered = malloc(on_count + 1);
+	uint8_t *times = malloc(on_count + 1);
+	if(covered == NULL || times == NULL)
+	{
+		printf("out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	cover->count = 0;
+	memset(covered, 0, on_count);
+	for(int i = 0; i < on_count; i++)
+	{
+		if(covered[i])
+			continue;
+		struct cube cube = expand_cube((struct cube){on[i], 0xFFFF}, on, covered, on_count, off, off_count);
+		add_cube(cover, cube);
+		for(int k = i; k < on_count; k++)
+			covered[k] |= IN_CUBE(on[k], cube);
+	}
+	qsort(cover->cubes, cover->count, sizeof(struct cube), by_cube_size);
+	make_irredundant(cover, on, on_count, times);
+
+	for(int pass = 0; pass < 8; pass++)
+	{
+		int cubes = cover->count, literals = cover_literals(cover);
+		struct cube *saved = malloc(cover->count * sizeof(struct cube) + 1);
+		memcpy(saved, cover->cubes, cover->count * sizeof(struct cube));
+
+		//reduce: shrink every cube to the supercube of the on points nothing else covers
+		count_coverage(cover, on, on_count, times);
+		for(int c = 0; c < cover->count; )
+		{
+			uint16_t all_ones = 0xFFFF, all_zeros = 0xFFFF;
+			int unique = 0;
+			for(int i = 0; i < on_count; i++)
+				if(IN_CUBE(on[i], cover->cubes[c]) && times[i] == 1)
+				{
+					all_ones &= on[i];
+					all_zeros &= ~on[i];
+					unique++;
+				}
+			for(int i = 0; i < on_count; i++)
+				if(IN_CUBE(on[i], cover->cubes[c]))
+					times[i]--;
+			if(!unique)
+			{
+				cover->cubes[c] = cover->cubes[--cover->count];
+				continue;
+			}
+			cover->cubes[c].mask = all_ones | all_zeros;
+			cover->cubes[c].value = all_ones;
+			for(int i = 0; i < on_count; i++)
+				if(IN_CUBE(on[i], cover->cubes[c]))
+					times[i]++;
+			c++;
+		}
+
+		//expand again, the gain counts the points the other cubes leave uncovered
+		for(int c = 0; c < cover->count; c++)
+		{
+			for(int i = 0; i < on_count; i++)
+			{
+				covered[i] = 0;
+				for(int k = 0; k < cover->count && !covered[i]; k++)
+					covered[i] = k != c && IN_CUBE(on[i], cover->cubes[k]);
+			}
+			cover->cubes[c] = expand_cube(cover->cubes[c], on, covered, on_count, off, off_count);
+		}
+		qsort(cover->cubes, cover->count, sizeof(struct cube), by_cube_size);
+		make_irredundant(cover, on, on_count, times);
+
+		int better = cover->count < cubes || (cover->count == cubes && cover_literals(cover) < literals);
+		if(!better)
+		{
+			if(cover->count > cubes || (cover->count == cubes && cover_literals(cover) > literals))
+			{
+				memcpy(cover->cubes, saved, cubes * sizeof(struct cube));
+				cover->count = cubes;
+			}
+			free(saved);
+			break;
+		}
+		free(saved);
+	}
+	free(covered);
+	free(times);
+}
+
+static void write_product(FILE *fPtr, struct cube cube)
+{
+	int first = 1;
+	for(int bit = 15; bit >= 0; bit--)
+	{
+		if(!(cube.mask & 1 << bit))
+			continue;
+		fprintf(fPtr, "%s%s%s", first ? "" : " & ", cube.value & 1 << bit ? "" : "!", pla_input_names[bit]);
+		first = 0;
+	}
+}
+
+/*
+minimize every control bit and write the equations as a CUPL source (file_name), the cover of every bit
+is checked against the control store before it is written. returns the number of bits that failed the check
+*/
+int write_pla_equations(const control_word *store, const uint8_t *written, const char *file_name)
+{
+	uint16_t *on = malloc(EEPROM_SIZE * sizeof(uint16_t));
+	uint16_t *off = malloc(EEPROM_SIZE * sizeof(uint16_t));
+	struct cover cover = {NULL, 0, 0};
+	struct timespec t_start, t_end;
+	int total_cubes = 0, total_literals = 0, failed = 0;
+
+	FILE * fPtr = fopen(file_name, "w");
+	if(fPtr == NULL || on == NULL || off == NULL)
+	{
+		printf("Unable to create file %s.\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	fprintf(fPtr, "Name     microcode ;\nPartNo   00 ;\nDate     ;\nRevision 01 ;\nDesigner ;\nCompany  ;\nAssembly ;\nLocation ;\nDevice   virtual ;\n\n");
+	fprintf(fPtr, "/* generated by microcode_generator, do not edit. unused control store addresses are don't care */\n\n");
+	fprintf(fPtr, "/* control store address: IR7..IR0 instruction register, ST3..ST0 micro step, Z N C I condition */\n");
+	for(int bit = 15; bit >= 0; bit--)
+		fprintf(fPtr, "PIN = %s ;\n", pla_input_names[bit]);
+	fprintf(fPtr, "\n");
+	int driven = 0;
+	for(int bit = CONTROL_BITS - 1; bit >= 0; bit--)
+		if(control_bit_names[bit])
+		{
+			fprintf(fPtr, "PIN = %s ;\n", control_bit_names[bit]);
+			driven++;
+		}
+
+	printf("minimizing %d control bits%s\n", driven, written ? "" : " (no occupancy map, every address is cared for)");
+	printf("  %-10s %6s %6s %6s %8s\n", "signal", "on", "cubes", "terms", "ms");
+	for(int bit = CONTROL_BITS - 1; bit >= 0; bit--)
+	{
+		int on_count = 0, off_count = 0;
+
+		if(!control_bit_names[bit])
+			continue;
+
+		clock_gettime(CLOCK_MONOTONIC, &t_start);
+		for(int addr = 0; addr < EEPROM_SIZE; addr++)
+		{
+			if(written && !(written[addr>>3] & (1 << (addr&7))))
+				continue;
+			if(store[addr] >> bit & 1)
+				on[on_count++] = addr;
+			else
+				off[off_count++] = addr;
+		}
+		minimize_bit(on, on_count, off, off_count, &cover);
+		clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+		//every cared address must come out of the equation as it is in the store
+		int wrong = 0;
+		for(int i = 0; i < on_count && !wrong; i++)
+		{
+			int hit = 0;
+			for(int c = 0; c < cover.count && !hit; c++)
+				hit = IN_CUBE(on[i], cover.cubes[c]);
+			wrong = !hit;
+		}
+		for(int c = 0; c < cover.count && !wrong; c++)
+			wrong = cube_hits(cover.cubes[c], off, off_count);
+		if(wrong)
+		{
+			printf("  %-10s cover does not match the control store\n", control_bit_names[bit]);
+			failed++;
+		}
+
+		int literals = cover_literals(&cover);
+		total_cubes += cover.count;
+		total_literals += literals;
+		printf("  %-10s %6d %6d %6d %8.1f\n", control_bit_names[bit], on_count, cover.count, literals, elapsed_ms(t_start, t_end));
+
+		fprintf(fPtr, "\n%s = ", control_bit_names[bit]);
+		if(cover.count == 0)
+			fprintf(fPtr, "'b'0");
+		for(int c = 0; c < cover.count; c++)
+		{
+			if(cover.cubes[c].mask == 0)
+			{
+				fprintf(fPtr, "'b'1");
+				break;
+			}
+			if(c)
+				fprintf(fPtr, "\n    # ");
+			write_product(fPtr, cover.cubes[c]);
+		}
+		fprintf(fPtr, " ;\n");
+	}
+	if(ferror(fPtr) || fclose(fPtr) != 0)
+	{
+		printf("oh no, the write failed for %s!!!\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	printf("  %d product terms, %d literals, written to %s\n", total_cubes, total_literals, file_name);
+	free(cover.cubes);
+	free(on);
+	free(off);
+	return failed;
+}
+
+static const char *alu_op_names[8] = {"ALU_NOP", "ALU_SHF", "ALU_ADD", "ALU_SUB", "ALU_NOT", "ALU_XOR", "ALU_ORR", "ALU_AND"};
+
+// control word as signal names, "NS4 LOAD_MAR0 GATE_PC0"
+static void print_signals(FILE *out, control_word word)
+{
+	fprintf(out, "NS%d", NEXT_STEP(word));
+	for(int bit = CONTROL_BITS - 1; bit >= 0; bit--)
+	{
+		if((NS15 >> bit) & 1)
+			continue;
+		if(((ALU2|ALU1|ALU0) >> bit) & 1)
+		{
+			if(bit == ALU2_AT && (word & (ALU2|ALU1|ALU0)))
+				fprintf(out, " %s", alu_op_names[ALU_OP(word)]);
+			continue;
+		}
+		if(word >> bit & 1)
+			fprintf(out, " %s", ADD_INC == LOAD_IO && bit == LOAD_IO_AT && (word & (ALU2|ALU1|ALU0)) ? "ADD_INC"
+				: control_bit_names[bit] ? control_bit_names[bit] : "?");
+	}
+}
+
+/*
+timing model: the longest path through one microstep, from the clock edge to the setup of whatever latches at the next edge.
+
+the control word is valid clock_to_q + eeprom_access after the edge (the step counter and the flags feed the eeprom address).
+the bus source adds its own delay: the ram is addressed by MAR from the edge and enabled by GATE_MEM, the alu output goes
+through its logic (and the carry chain for ADD/SUB) and the bus buffer, a register is just enabled onto the bus.
+every LOAD_* needs the bus plus latch setup, an alu operation also sets the flags through the zero detect,
+the step counter and INCR_PC only need the control word
+*/
+struct delays{
+	double clock_to_q;        //register and step counter clock to output
+	double eeprom_access;     //control store tAA
+	double ram_access;        //ram address to data
+	double ram_output_enable; //ram output enable to data
+	double ram_write_setup;   //data setup before the end of the write pulse
+	double bus_enable;        //bus buffer output enable
+	double bus_buffer;        //bus buffer propagation
+	double alu_logic;         //one level of alu gates and the operation select
+	double carry_chain;       //ripple through the 8 bit adder
+	double zero_detect;       //flag logic after the alu result
+	double io_access;         //io port select to data
+	double latch_setup;       //register setup
+	double counter_setup;     //pc and step counter load/count enable setup
+};
+
+//74HC logic, a 150 ns 28C256 control store and a 70 ns 62256 ram
+static const struct delays default_delays = {20, 150, 70, 35, 30, 25, 10, 25, 60, 20, 100, 15, 20};
+
+#define DELAY(field) {#field, offsetof(struct delays, field)}
+static const struct { const char *name; size_t offset; } delay_fields[] = {
+	DELAY(clock_to_q), DELAY(eeprom_access), DELAY(ram_access), DELAY(ram_output_enable), DELAY(ram_write_setup),
+	DELAY(bus_enable), DELAY(bus_buffer), DELAY(alu_logic), DELAY(carry_chain), DELAY(zero_detect),
+	DELAY(io_access), DELAY(latch_setup), DELAY(counter_setup),
+};
+#define DELAY_FIELDS ((int) (sizeof(delay_fields) / sizeof(delay_fields[0])))
+
+// delay table file, lines of "name ns" for the fields to change, # comments
+static void load_delays(const char *file_name, struct delays *delays)
+{
+	char line[256], name[64];
+	double value;
+	int line_no = 0;
+
+	FILE *fPtr = fopen(file_name, "r");
+	if(fPtr == NULL)
+	{
+		printf("Unable to open file %s.\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	while(fgets(line, sizeof(line), fPtr))
+	{
+		line_no++;
+		line[strcspn(line, "#\r\n")] = 0;
+		int got = sscanf(line, "%63s %lf", name, &value);
+		if(got <= 0)
+			continue;
+		int field;
+		for(field = 0; field < DELAY_FIELDS; field++)
+			if(strcmp(delay_fields[field].name, name) == 0)
+				break;
+		if(got != 2 || field == DELAY_FIELDS)
+		{
+			printf("%s:%d: expected \"<delay name> <ns>\", the names are:", file_name, line_no);
+			for(field = 0; field < DELAY_FIELDS; field++)
+				printf(" %s", delay_fields[field].name);
+			printf("\n");
+			exit(EXIT_FAILURE);
+		}
+		*(double *) ((char *) delays + delay_fields[field].offset) = value;
+	}
+	fclose(fPtr);
+}
+
+// critical path of one control word in ns, *bound names what the path goes through
+static double step_delay(control_word word, const struct delays *d, const char **bound)
+{
+	double control = d->clock_to_q + d->eeprom_access;
+	double path = control + d->counter_setup; //next step, and INCR_PC
+	double bus = -1;
+	const char *source = NULL;
+	int alu = ALU_OP(word);
+
+	*bound = "control store";
+	if((word & GATE_MEM) && !(word & WRITE))
+	{
+		bus = d->clock_to_q + d->ram_access;
+		if(control + d->ram_output_enable > bus)
+			bus = control + d->ram_output_enable;
+		source = "memory";
+	}
+	if(alu)
+	{
+		double result = control + d->alu_logic + (alu == ALU_OP(ALU_ADD) || alu == ALU_OP(ALU_SUB) ? d->carry_chain : 0);
+		double flags = result + d->zero_detect + d->latch_setup;
+		bus = result + d->bus_buffer;
+		if(control + d->bus_enable > bus)
+			bus = control + d->bus_enable;
+		source = alu == ALU_OP(ALU_ADD) || alu == ALU_OP(ALU_SUB) ? "carry chain" : "alu";
+		if(flags > path)
+		{
+			path = flags;
+			*bound = alu == ALU_OP(ALU_ADD) || alu == ALU_OP(ALU_SUB) ? "carry chain + flags" : "alu + flags";
+		}
+	}
+	if(word & (GATE_C|GATE_PC0|GATE_PC1))
+	{
+		double gated = control + d->bus_enable;
+		if(gated > bus)
+		{
+			bus = gated;
+			source = "bus gate";
+		}
+	}
+	if(word & GATE_IO)
+	{
+		double io = d->clock_to_q + d->io_access;
+		if(control + d->bus_enable > io)
+			io = control + d->bus_enable;
+		if(io > bus)
+		{
+			bus = io;
+			source = "io";
+		}
+	}
+	if(bus < 0)
+		bus = control; //nothing drives the bus, a load still needs the control word
+	if(word & (LOAD_MAR0|LOAD_MAR1|LOAD_IR|LOAD_A|LOAD_B|LOAD_C|LOAD_IO|WRITE_IO))
+	{
+		if(bus + d->latch_setup > path)
+		{
+			path = bus + d->latch_setup;
+			*bound = source ? source : "control store";
+		}
+	}
+	if(word & (LOAD_PC0|LOAD_PC1))
+	{
+		if(bus + d->counter_setup > path)
+		{
+			path = bus + d->counter_setup;
+			*bound = source ? source : "control store";
+		}
+	}
+	if(word & WRITE)
+	{
+		if(bus + d->ram_write_setup > path)
+		{
+			path = bus + d->ram_write_setup;
+			*bound = source ? source : "control store";
+		}
+	}
+	return path;
+}
+
+struct step_time{
+	uint16_t addr;  //ir << 8 | step << 4, the slowest condition value
+	double ns;
+	const char *bound;
+};
+
+static int by_delay(const void *x, const void *y)
+{
+	double a = ((const struct step_time *) x)->ns, b = ((const struct step_time *) y)->ns;
+	return a < b ? 1 : a > b ? -1 : 0;
+}
+
+// name of the opcode a step belongs to, a FAST_FETCH form is named after its opcode with "+f"
+static const char *step_opcode_name(int ir, char *buffer, size_t size)
+{
+	const char *name = opcode_name(ir);
+	if(name == NULL && FAST_FETCH_ROUTED(ir) && (ir << 8 & FAST_FETCH) && (name = opcode_name(ir & ~(FAST_FETCH >> 8))) != NULL)
+	{
+		snprintf(buffer, size, "%s+f", name);
+		return buffer;
+	}
+	return name ? name : "?";
+}
+
+// critical path of every populated microstep, the slowest ones and the slowest step of every opcode
+static void print_timing(const control_word *store, const uint8_t *written, const struct delays *d, int worst)
+{
+	static struct step_time steps[4096];
+	int count = 0, bound_count = 0;
+	const char *bounds[16];
+	int per_bound[16] = {0};
+
+	printf("delays (ns):");
+	for(int field = 0; field < DELAY_FIELDS; field++)
+		printf("%s %s %.0f", field % 5 ? "," : "\n ", delay_fields[field].name, *(const double *) ((const char *) d + delay_fields[field].offset));
+	printf("\n");
+
+	for(int base = 0; base < EEPROM_SIZE; base += 16)
+	{
+		struct step_time t = {0, -1, NULL};
+		for(int cond = 0; cond < 16; cond++)
+		{
+			int addr = base | cond;
+			if(written ? !(written[addr>>3] & (1 << (addr&7))) : store[addr] == FILL_WORD)
+				continue;
+			const char *bound;
+			double ns = step_delay(store[addr], d, &bound);
+			if(ns > t.ns)
+				t = (struct step_time){addr, ns, bound};
+		}
+		if(t.ns < 0)
+			continue;
+		steps[count++] = t;
+		int b;
+		for(b = 0; b < bound_count && bounds[b] != t.bound; b++)
+			;
+		if(b == bound_count)
+			bounds[bound_count++] = t.bound;
+		per_bound[b]++;
+	}
+	if(count == 0)
+	{
+		printf("no populated micro steps\n");
+		return;
+	}
+	qsort(steps, count, sizeof(steps[0]), by_delay);
+
+	printf("slowest micro steps\n");
+	printf("  %-10s %4s %4s %4s %8s  %-20s %s\n", "opcode", "ir", "step", "cond", "ns", "bound by", "signals");
+	for(int i = 0; i < count && i < worst; i++)
+	{
+		int addr = steps[i].addr, ir = addr >> 8;
+		char label[16];
+		printf("  %-10s %02x   S%-3d %x    %8.1f  %-20s ", step_opcode_name(ir, label, sizeof(label)), ir, (addr >> 4) & 0xF, addr & 0xF, steps[i].ns, steps[i].bound);
+		print_signals(stdout, store[addr]);
+		printf("\n");
+	}
+
+	printf("slowest step of every opcode\n");
+	for(int ir = 0; ir < 256; ir++)
+		for(int i = 0; i < count; i++)
+			if(steps[i].addr >> 8 == ir)
+			{
+				char label[16];
+				printf("  %-10s %02x   S%-3d %8.1f ns  %s\n", step_opcode_name(ir, label, sizeof(label)), ir, (steps[i].addr >> 4) & 0xF, steps[i].ns, steps[i].bound);
+				break;
+			}
+
+	printf("steps by what bounds them:");
+	for(int b = 0; b < bound_count; b++)
+		printf("%s %s %d", b ? "," : "", bounds[b], per_bound[b]);
+	printf("\n");
+
+	//the clock only rises once every step at the current worst delay is rewritten
+	int at_worst = 0;
+	while(at_worst < count && steps[at_worst].ns == steps[0].ns)
+		at_worst++;
+	printf("critical path %.1f ns (%s), safe clock %.2f MHz\n", steps[0].ns, steps[0].bound, 1000.0 / steps[0].ns);
+	if(at_worst < count)
+		printf("%d step%s at %.1f ns, rewriting %s would allow %.2f MHz\n", at_worst, at_worst > 1 ? "s" : "", steps[0].ns,
+			at_worst > 1 ? "them" : "it", 1000.0 / steps[at_worst].ns);
+}
+
+// timing report with the built in delays ("default") or the ones of a delay file
+void timing_report(const control_word *store, const uint8_t *written, const char *delay_file)
+{
+	struct delays delays = default_delays;
+	if(strcmp(delay_file, "default") != 0)
+		load_delays(delay_file, &delays);
+	print_timing(store, written, &delays, 20);
+}
+
+/*
+emulator of the breadboard cpu driven by the control store.
+
+every microstep the control unit reads the word at ir<<8 | step<<4 | condition bits, one source drives the 8 bit bus
+and every LOAD_* latches it at the clock edge, so a step reads the state from before the edge (GATE_PC1 + INCR_PC put the old pc on the bus).
+the alu drives the bus whenever an alu operation is selected (there is no separate gate signal), the carry in is ADD_INC.
+nothing driving the bus reads as 0, WRITE turns GATE_MEM into the write enable instead of a bus source.
+*/
+enum bus_source{
+	BUS_NONE,
+	BUS_MEM,
+	BUS_ALU,
+	BUS_C,
+	BUS_PC0,
+	BUS_PC1,
+	BUS_IO,
+};
+
+//one decoded control word, built once per distinct word instead of testing the signal bits every step
+struct action{
+	control_word word;
+	uint8_t bus;     //enum bus_source
+	uint8_t alu;     //ALU_OP of the word
+	uint8_t contention; //more than one source drive the bus
+	uint8_t next_step;
+	control_word loads;  //the word masked to the signals that latch something
+};
+
+struct cpu{
+	uint8_t mem[EEPROM_SIZE];
+	uint8_t io[256];
+	uint16_t pc;
+	uint8_t mar0, mar1, a, b, c, ir, io_select;
+	uint8_t flags;   //C, N and Z in their condition code position, I is the interrupt line
+	uint8_t step;
+	uint64_t microsteps, instructions, contentions;
+	int halted;
+	int fast_fetch;             //drive the FAST_FETCH comparator at every S0
+	const struct decoded_store *decoded; //the control store as actions, see decode_control_store()
+	uint16_t fast;              //FAST_FETCH while the latch is set, ored into the address outside the jump group
+	struct op_profile *profile; //optional, 256 entries indexed by ir
+	int current_op;             //ir of the instruction being profiled, -1 before the first fetch
+	uint32_t op_steps;          //microsteps since the current instruction's S0
+	uint8_t profile_step;       //step before the current one, to see an overlapped entry
+	uint32_t interrupt_period;  //raise I every this many microsteps, 0 for never
+	uint32_t interrupt_timer;
+	int in_handler;             //from the dispatch to RTI, the controller holds further requests
+	int dispatching;            //between the dispatch and the handler's first fetch
+	uint64_t raised_at;         //microstep I went up
+	uint64_t interrupts, latency_max, latency_total;
+};
+
+//instruction mix, an instruction is charged from its own S0 fetch step to the next S0
+struct op_profile{
+	uint64_t count;
+	uint64_t cycles;
+};
+
+#define MAX_ACTIONS 4096
+
+//owned by one emulator run, so any number of runs can go at the same time
+struct decoded_store{
+	struct action actions[MAX_ACTIONS];
+	int action_count;
+	uint16_t action_of[EEPROM_SIZE]; //address to index into actions
+	uint8_t halts[EEPROM_SIZE/8];    //address whose step only loops onto itself, like STP+S3
+};
+
+static struct action decode_word(control_word word)
+{
+	struct action act = {0};
+	int sources = 0;
+
+	act.word = word;
+	act.alu = ALU_OP(word);
+	act.next_step = NEXT_STEP(word);
+	act.loads = word & (LOAD_MAR0 + LOAD_MAR1 + WRITE + LOAD_IR + LOAD_A + LOAD_B + LOAD_C + LOAD_PC0 + LOAD_PC1 + INCR_PC + LOAD_IO + WRITE_IO);
+	act.bus = BUS_NONE;
+	if((word & GATE_MEM) && !(word & WRITE)) { act.bus = BUS_MEM; sources++; }
+	if(act.alu != 0) { act.bus = BUS_ALU; sources++; }
+	if(word & GATE_C) { act.bus = BUS_C; sources++; }
+	if(word & GATE_PC0) { act.bus = BUS_PC0; sources++; }
+	if(word & GATE_PC1) { act.bus = BUS_PC1; sources++; }
+	if(word & GATE_IO) { act.bus = BUS_IO; sources++; }
+	act.contention = sources > 1;
+	return act;
+}
+
+// decode every address of the control store once, identical words share one action
+static void decode_control_store(const control_word *store, struct decoded_store *d)
+{
+	struct action *actions = d->actions;
+
+	d->action_count = 0;
+	memset(d->halts, 0, sizeof(d->halts));
+	for(int addr = 0; addr < EEPROM_SIZE; addr++)
+	{
+		control_word word = store[addr];
+		int index;
+		for(index = 0; index < d->action_count; index++)
+			if(actions[index].word == word)
+				break;
+		if(index == d->action_count)
+		{
+			if(d->action_count == MAX_ACTIONS)
+			{
+				printf("more than %d distinct control words, cannot decode\n", MAX_ACTIONS);
+				exit(EXIT_FAILURE);
+			}
+			actions[d->action_count++] = decode_word(word);
+		}
+		d->action_of[addr] = index;
+		if((word & ~NS15) == 0 && actions[index].next_step == ((addr >> 4) & 0xF))
+			d->halts[addr>>3] |= 1 << (addr&7);
+	}
+}
+
+static uint8_t alu_result(const struct cpu *cpu, int alu, int carry_in, int *carry_out)
+{
+	unsigned result;
+
+	switch(alu)
+	{
+		case ALU_OP(ALU_SHF): result = cpu->a >> 1; *carry_out = cpu->a & 1; return result;
+		case ALU_OP(ALU_ADD): result = cpu->a + cpu->b + carry_in; break;
+		case ALU_OP(ALU_SUB): result = cpu->a + (uint8_t) ~cpu->b + carry_in; break;
+		case ALU_OP(ALU_NOT): result = (uint8_t) ~cpu->a; break;
+		case ALU_OP(ALU_XOR): result = cpu->a ^ cpu->b; break;
+		case ALU_OP(ALU_ORR): result = cpu->a | cpu->b; break;
+		case ALU_OP(ALU_AND): result = cpu->a & cpu->b; break;
+		default: result = 0; break;
+	}
+	*carry_out = result > 0xFF;
+	return (uint8_t) result;
+}
+
+// one microstep: drive the bus, run the alu, latch at the clock edge and move to the next step
+static inline void execute_action(struct cpu *cpu, const struct action *act)
+{
+	control_word loads = act->loads;
+	uint8_t bus = 0;
+	int carry = 0;
+
+	switch(act->bus)
+	{
+		case BUS_MEM: bus = cpu->mem[cpu->mar1 << 8 | cpu->mar0]; break;
+		case BUS_ALU: bus = alu_result(cpu, act->alu, (act->word & ADD_INC) != 0, &carry); break;
+		case BUS_C: bus = cpu->c; break;
+		case BUS_PC0: bus = (uint8_t) cpu->pc; break;
+		case BUS_PC1: bus = cpu->pc >> 8; break;
+		case BUS_IO: bus = cpu->io[cpu->io_select]; break;
+	}
+	cpu->contentions += act->contention;
+	if(act->alu != 0)
+		cpu->flags = (cpu->flags & I) | (carry ? C : 0) | (bus & 0x80 ? N : 0) | (bus == 0 ? Z : 0);
+
+	if(loads)
+	{
+		if(loads & WRITE) cpu->mem[cpu->mar1 << 8 | cpu->mar0] = bus;
+		if(loads & WRITE_IO) cpu->io[cpu->io_select] = bus;
+		if(loads & LOAD_MAR0) cpu->mar0 = bus;
+		if(loads & LOAD_MAR1) cpu->mar1 = bus;
+		if(loads & LOAD_A) cpu->a = bus;
+		if(loads & LOAD_B) cpu->b = bus;
+		if(loads & LOAD_C) cpu->c = bus;
+		if(loads & LOAD_IO) cpu->io_select = bus;
+		if(loads & INCR_PC) cpu->pc++;
+		if(loads & LOAD_PC0) cpu->pc = (cpu->pc & 0xFF00) | bus;
+		if(loads & LOAD_PC1) cpu->pc = (cpu->pc & 0x00FF) | bus << 8;
+		if(loads & LOAD_IR)
+		{
+			cpu->ir = bus;
+			//after the fast fetch S2 can only load ir a second time (an opcode that keeps its steps, or the jump group)
+			if(!(cpu->step == 2 && cpu->fast))
+			{
+				cpu->instructions++;
+				if(cpu->profile)
+				{
+					cpu->current_op = bus;
+					cpu->profile[bus].count++;
+				}
+			}
+		}
+	}
+	cpu->step = act->next_step;
+}
+
+// S0 with interrupts on: the dispatch (I set) is acknowledged, the handler's first fetch ends the latency, RTI ends the handler
+static void interrupt_boundary(struct cpu *cpu, uint64_t now)
+{
+	if(cpu->dispatching)
+	{
+		uint64_t latency = now - cpu->raised_at;
+		cpu->dispatching = 0;
+		cpu->interrupts++;
+		cpu->latency_total += latency;
+		if(latency > cpu->latency_max)
+			cpu->latency_max = latency;
+	}
+	else if(cpu->flags & I)
+	{
+		cpu->flags &= ~I; //the controller drops I once the dispatch takes it
+		cpu->dispatching = 1;
+		cpu->in_handler = 1;
+	}
+	else if(cpu->in_handler && cpu->ir == IR_OF(RTI))
+		cpu->in_handler = 0;
+}
+
+// run until a halt step or max_steps microsteps, returns the number of microsteps executed
+static uint64_t emulate(struct cpu *cpu, uint64_t max_steps)
+{
+	uint64_t executed;
+
+	for(executed = 0; executed < max_steps; executed++)
+	{
+		if(cpu->interrupt_period && !cpu->in_handler && !(cpu->flags & I) && ++cpu->interrupt_timer >= cpu->interrupt_period)
+		{
+			cpu->interrupt_timer = 0;
+			cpu->flags |= I;
+			cpu->raised_at = cpu->microsteps + executed;
+		}
+		//FAST_FETCH is latched at S0: MAR1 already holds pc1, the next FAST_FETCH_SPAN byte stay in this page,
+		//I is low (the dispatch runs the plain entry) and ir is outside the jump group, whose S0 cannot see the latch
+		if(cpu->fast_fetch && cpu->step == 0)
+			cpu->fast = cpu->mar1 == cpu->pc >> 8 && (cpu->pc & 0xFF) <= 0x100 - FAST_FETCH_SPAN && !(cpu->flags & I)
+				&& FAST_FETCH_ROUTED(cpu->ir) ? FAST_FETCH : 0;
+		int addr = cpu->ir << 8 | cpu->step << 4 | cpu->flags | (FAST_FETCH_ROUTED(cpu->ir) ? cpu->fast : 0);
+		if(cpu->interrupt_period && cpu->step == 0)
+			interrupt_boundary(cpu, cpu->microsteps + executed);
+		//STP only waits when an interrupt can still come
+		if((cpu->decoded->halts[addr>>3] & (1 << (addr&7))) && (!cpu->interrupt_period || cpu->in_handler))
+		{
+			cpu->halted = 1;
+			break;
+		}
+		const struct action *act = &cpu->decoded->actions[cpu->decoded->action_of[addr]];
+
+		if(cpu->profile)
+		{
+			//an instruction starts at S0, or at S1/S2 after a last step that overlapped the fetch (-O)
+			int entered = cpu->step == 0 || (cpu->step < 3 && cpu->profile_step >= 3 && !cpu->fast_fetch);
+			if(entered && cpu->current_op >= 0)
+			{
+				cpu->profile[cpu->current_op].cycles += cpu->op_steps;
+				cpu->op_steps = 0;
+			}
+			cpu->op_steps++;
+			cpu->profile_step = cpu->step;
+		}
+		execute_action(cpu, act);
+	}
+	cpu->microsteps += executed;
+	return executed;
+}
+
+/*
+microsteps one instruction takes from its S0 to the next S0 with the condition bits held at flags,
+including the 3 step fetch. -1 if it never gets back to S0 (STP, or a step loop).
+a last step that overlaps the next fetch (-O) and goes on at S1/S2 is credited with the fetch steps it saved
+*/
+static int instruction_cycles(const control_word *store, int ir, int flags)
+{
+	int step = 0;
+
+	for(int cycles = 1; cycles <= 64; cycles++)
+	{
+		int next = NEXT_STEP(store[ir << 8 | step << 4 | flags]);
+		if(next == 0)
+			return cycles;
+		if(next < 3 && step >= 3 && !(flags & FAST_FETCH))
+			return cycles - next;
+		step = next;
+	}
+	return -1;
+}
+
+/*
+worst case interrupt latency of one opcode under the condition bits flags, in microsteps from I going up just after
+S0 looked at it to the first fetch step of the handler: the rest of the instruction, its S0 with I set and the entry.
+-1 when the instruction never gets back to S0 with I set (a step loop), -2 when S0 has no dispatch
+*/
+static int interrupt_latency(const control_word *store, int ir, int flags)
+{
+	int step = NEXT_STEP(store[ir << 8 | flags]), cycles = 0;
+
+	while(step != 0)
+	{
+		if(++cycles > 64)
+			return -1;
+		step = NEXT_STEP(store[ir << 8 | step << 4 | flags | I]);
+	}
+	control_word word = store[ir << 8 | flags | I];
+	if(decode_word(word).bus != BUS_NONE || !(word & LOAD_IR))
+		return -2;
+	for(ir = 0; ; ) //the dispatch loaded ir from the empty bus
+	{
+		cycles++;
+		step = NEXT_STEP(word);
+		if(step == 0)
+			return cycles;
+		if(cycles > 128)
+			return -1;
+		word = store[ir << 8 | step << 4 | flags];
+	}
+}
+
+// does the sequence of an opcode use the io port, under any condition value without I
+static int uses_io(const control_word *store, int ir)
+{
+	for(int flags = 0; flags < 16; flags += 2)
+	{
+		int step = 0;
+		for(int n = 0; n < 64; n++)
+		{
+			control_word word = store[ir << 8 | step << 4 | flags];
+			if(word & (GATE_IO|WRITE_IO) || (word & LOAD_IO && (ADD_INC != LOAD_IO || !(word & (ALU2|ALU1|ALU0)))))
+				return 1;
+			if((step = NEXT_STEP(word)) == 0)
+				break;
+		}
+	}
+	return 0;
+}
+
+void print_interrupt_latency(const control_word *store)
+{
+	int worst = 0, worst_ir = -1, worst_io = 0, unbounded = 0;
+
+	if(store[NOP | S0 | I] != INT_DISPATCH)
+	{
+		printf("no interrupt dispatch in the control store, generate it with -i\n");
+		return;
+	}
+	printf("interrupt latency, microsteps from I going up just after S0 to the handler's first fetch step\n");
+	printf("  %-10s %4s %10s %s\n", "opcode", "ir", "worst", "");
+	for(int i = 0; opcode_names[i].name; i++)
+	{
+		int ir = IR_OF(opcode_names[i].input), latency = 0, io = uses_io(store, ir);
+		if(!opcode_generated(store, ir))
+		{
+			printf("  %-10s %02x   %10s\n", opcode_names[i].name, ir, "not generated");
+			continue;
+		}
+		for(int flags = 0; flags < 16 && latency >= 0; flags += 2)
+		{
+			int l = interrupt_latency(store, ir, flags);
+			latency = l < 0 ? l : l > latency ? l : latency;
+		}
+		printf("  %-10s %02x   ", opcode_names[i].name, ir);
+		if(latency == -2)
+			printf("%10s", "no dispatch");
+		else if(latency < 0)
+			printf("%10s", "unbounded");
+		else
+			printf("%10d", latency);
+		printf("%s\n", io ? "  io" : "");
+		if(latency < 0)
+		{
+			unbounded++;
+			continue;
+		}
+		if(latency > worst)
+		{
+			worst = latency;
+			worst_ir = ir;
+		}
+		if(io && latency > worst_io)
+			worst_io = latency;
+	}
+	if(worst_ir >= 0)
+		printf("worst case %d microsteps (%s), %d on the io instructions\n", worst, opcode_name(worst_ir), worst_io);
+	if(unbounded)
+		printf("%d opcode%s never reach S0 again (a step loop), an interrupt can wait forever there\n", unbounded, unbounded > 1 ? "s" : "");
+}
+
+static void print_cycles(FILE *out, int cycles)
+{
+	if(cycles < 0)
+		fprintf(out, "%8s", "never");
+	else
+		fprintf(out, "%8d", cycles);
+}
+
+// cycles per instruction of every opcode and mode, conditional jumps both taken and not taken
+void print_cpi_table(const control_word *store)
+{
+	printf("%-10s %4s %8s %10s %8s %10s\n", "opcode", "ir", "cycles", "not taken", "fast", "not taken");
+	for(int i = 0; opcode_names[i].name; i++)
+	{
+		int ir = IR_OF(opcode_names[i].input);
+		//the fast form exists when S0 with FAST_FETCH set already increments the pc
+		int forms = FAST_FETCH_ROUTED(ir) && store[ir << 8 | S0 | FAST_FETCH] & INCR_PC ? 2 : 1;
+		printf("%-10s %02x   ", opcode_names[i].name, ir);
+		if(!opcode_generated(store, ir))
+		{
+			printf("%8s\n", "not generated");
+			continue;
+		}
+		for(int form = 0; form < forms; form++)
+		{
+			int fast = form ? FAST_FETCH : 0;
+			if(is_conditional_jump(ir))
+			{
+				print_cycles(stdout, instruction_cycles(store, ir, fast|C|N|Z));
+				printf("   ");
+				print_cycles(stdout, instruction_cycles(store, ir, fast));
+			}
+			else
+			{
+				print_cycles(stdout, instruction_cycles(store, ir, fast));
+				printf("   %8s", "");
+			}
+		}
+		printf("\n");
+	}
+}
+
+static int find_opcode(const char *name)
+{
+	for(int i = 0; opcode_names[i].name; i++)
+		if(strcmp(opcode_names[i].name, name) == 0)
+			return IR_OF(opcode_names[i].input);
+	return -1;
+}
+
+/*
+weighted cycles of an instruction trace, one instruction per line with an optional repeat count ("ADDI 120").
+a conditional jump counts as taken, append '-' for not taken ("JZ- 30"). blank lines and # comments are ignored
+*/
+static void weigh(const control_word *store, const char *trace, uint64_t *total_count, uint64_t *total_cycles)
+{
+	FILE *fPtr = fopen(trace, "r");
+	char line[256];
+	int line_no = 0;
+
+	if(fPtr == NULL)
+	{
+		printf("Unable to open file %s.\n", trace);
+		exit(EXIT_FAILURE);
+	}
+	while(fgets(line, sizeof(line), fPtr))
+	{
+		char name[64];
+		unsigned long long count = 1;
+		line_no++;
+		char *hash = strchr(line, '#');
+		if(hash)
+			*hash = 0;
+		if(sscanf(line, "%63s %llu", name, &count) < 1)
+			continue;
+
+		int not_taken = 0;
+		size_t len = strlen(name);
+		if(len > 1 && name[len-1] == '-')
+		{
+			name[len-1] = 0;
+			not_taken = 1;
+		}
+		int ir = find_opcode(name);
+		if(ir < 0)
+		{
+			printf("%s:%d: unknown instruction %s\n", trace, line_no, name);
+			exit(EXIT_FAILURE);
+		}
+		if(!opcode_generated(store, ir))
+		{
+			printf("%s:%d: %s is not generated with these options\n", trace, line_no, name);
+			exit(EXIT_FAILURE);
+		}
+		int cycles = instruction_cycles(store, ir, is_conditional_jump(ir) && !not_taken ? C|N|Z : 0);
+		if(cycles < 0)
+		{
+			printf("%s:%d: %s never returns to fetch, cannot weigh it\n", trace, line_no, name);
+			exit(EXIT_FAILURE);
+		}
+		*total_count += count;
+		*total_cycles += count * cycles;
+	}
+	fclose(fPtr);
+}
+
+void weigh_trace(const control_word *store, const char *trace)
+{
+	uint64_t total_count = 0, total_cycles = 0;
+
+	weigh(store, trace, &total_count, &total_cycles);
+	printf("%s: %llu instructions, %llu cycles, average CPI %.3f\n", trace,
+		(unsigned long long) total_count, (unsigned long long) total_cycles, total_count ? (double) total_cycles / total_count : 0.0);
+}
+
+// instruction mix of an emulator run, most expensive instruction first
+static void print_profile(struct op_profile *profile, uint64_t microsteps)
+{
+	int order[256], used = 0;
+
+	//insertion sort by cycles, at most 256 opcodes and no comparator state outside the call
+	for(int ir = 0; ir < 256; ir++)
+	{
+		if(!profile[ir].count)
+			continue;
+		int at = used++;
+		for(; at > 0 && profile[order[at - 1]].cycles < profile[ir].cycles; at--)
+			order[at] = order[at - 1];
+		order[at] = ir;
+	}
+
+	printf("%-10s %4s %12s %12s %8s %7s\n", "opcode", "ir", "count", "cycles", "CPI", "share");
+	for(int i = 0; i < used; i++)
+	{
+		int ir = order[i];
+		const char *name = opcode_name(ir);
+		printf("%-10s %02x   %12llu %12llu %8.3f %6.2f%%\n", name ? name : "?", ir,
+			(unsigned long long) profile[ir].count, (unsigned long long) profile[ir].cycles,
+			(double) profile[ir].cycles / profile[ir].count, microsteps ? 100.0 * profile[ir].cycles / microsteps : 0.0);
+	}
+}
+
+// load a raw program image at address 0 and run it on the given control store
+void run_program(const control_word *store, const char *program, uint64_t max_steps, int profiled, int fast_fetch,
+	uint32_t interrupt_period)
+{
+	struct cpu *cpu = calloc(1, sizeof(struct cpu));
+	struct decoded_store *decoded = malloc(sizeof(*decoded));
+	struct op_profile profile[256] = {{0}};
+	struct timespec t_start, t_end;
+
+	if(cpu == NULL || decoded == NULL)
+	{
+		printf("out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	cpu->current_op = -1;
+	cpu->decoded = decoded;
+	cpu->fast_fetch = fast_fetch;
+	cpu->interrupt_period = interrupt_period;
+	if(interrupt_period && store[NOP | S0 | I] != INT_DISPATCH)
+	{
+		printf("-q needs the interrupt dispatch (-i)\n");
+		exit(EXIT_FAILURE);
+	}
+	if(profiled)
+		cpu->profile = profile;
+	size_t size = read_file(program, cpu->mem, EEPROM_SIZE);
+	printf("running %s (%zu byte)\n", program, size);
+
+	decode_control_store(store, decoded);
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	emulate(cpu, max_steps);
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+	if(profiled && cpu->current_op >= 0) //charge the instruction the run stopped in
+		profile[cpu->current_op].cycles += cpu->op_steps;
+
+	double ms = elapsed_ms(t_start, t_end);
+	printf("%s after %llu microsteps, %llu instructions, %d distinct control words\n",
+		cpu->halted ? "halted" : "stopped", (unsigned long long) cpu->microsteps, (unsigned long long) cpu->instructions, decoded->action_count);
+	printf("pc=%04x ir=%02x step=%d mar=%02x%02x a=%02x b=%02x c=%02x io=%02x flags=%c%c%c\n",
+		cpu->pc, cpu->ir, cpu->step, cpu->mar1, cpu->mar0, cpu->a, cpu->b, cpu->c, cpu->io_select,
+		cpu->flags & C ? 'C' : '-', cpu->flags & N ? 'N' : '-', cpu->flags & Z ? 'Z' : '-');
+	if(cpu->interrupts)
+		printf("%llu interrupts, latency %.1f microsteps on average, %llu at most\n", (unsigned long long) cpu->interrupts,
+			(double) cpu->latency_total / cpu->interrupts, (unsigned long long) cpu->latency_max);
+	if(cpu->contentions)
+		printf("warning: %llu microsteps had more than one source driving the bus\n", (unsigned long long) cpu->contentions);
+	if(ms > 0)
+		printf("emulation: %.3f ms, %.1f million microsteps per second\n", ms, cpu->microsteps / ms / 1000.0);
+	if(profiled)
+		print_profile(profile, cpu->microsteps);
+	free(decoded);
+	free(cpu);
+}
+
+/*
+microstep compaction.
+
+two steps a -> b of one opcode merge into a when they can share a clock: at most one source drives the bus
+and every step that latches from the bus keeps the same source (a LOAD_* with nothing driving reads 0, so it cannot pick up a driver),
+b reads nothing a writes (everything latches at the same edge), they write nothing in common, b is only entered from a
+and neither depends on the condition bits. the fetch S0-S2 and LOAD_IR are never touched so every opcode still starts at S3.
+the remaining steps are renumbered from S3 and every NS* field rewritten to match.
+*/
+enum state_bit{
+	ST_MAR = 1 << 0,
+	ST_IR = 1 << 1,
+	ST_A = 1 << 2,
+	ST_B = 1 << 3,
+	ST_C = 1 << 4,
+	ST_PC = 1 << 5,
+	ST_IO_SELECT = 1 << 6,
+	ST_MEM = 1 << 7,
+	ST_IO_PORT = 1 << 8,
+	ST_FLAGS = 1 << 9,
+	ST_MAR0 = 1 << 10, //MAR0/MAR1 are written separately but read together as ST_MAR
+	ST_MAR1 = 1 << 11,
+};
+
+static unsigned state_read(control_word word)
+{
+	unsigned read = 0;
+	if((word & GATE_MEM) && !(word & WRITE)) read |= ST_MAR | ST_MEM;
+	if(word & WRITE) read |= ST_MAR;
+	if(word & (ALU2|ALU1|ALU0)) read |= ST_A | ST_B;
+	if(word & GATE_C) read |= ST_C;
+	if(word & (GATE_PC0|GATE_PC1|INCR_PC)) read |= ST_PC;
+	if(word & GATE_IO) read |= ST_IO_SELECT | ST_IO_PORT;
+	if(word & WRITE_IO) read |= ST_IO_SELECT;
+	if(read & ST_MAR) read |= ST_MAR0 | ST_MAR1;
+	return read;
+}
+
+static unsigned state_written(control_word word)
+{
+	unsigned written = 0;
+	if(word & LOAD_MAR0) written |= ST_MAR0;
+	if(word & LOAD_MAR1) written |= ST_MAR1;
+	if(word & LOAD_IR) written |= ST_IR;
+	if(word & LOAD_A) written |= ST_A;
+	if(word & LOAD_B) written |= ST_B;
+	if(word & LOAD_C) written |= ST_C;
+	if(word & (LOAD_PC0|LOAD_PC1|INCR_PC)) written |= ST_PC;
+	if(word & LOAD_IO) written |= ST_IO_SELECT;
+	if(word & WRITE) written |= ST_MEM;
+	if(word & WRITE_IO) written |= ST_IO_PORT;
+	if(word & (ALU2|ALU1|ALU0)) written |= ST_FLAGS;
+	return written;
+}
+
+#define BUS_LOADS (LOAD_MAR0 + LOAD_MAR1 + LOAD_IR + LOAD_A + LOAD_B + LOAD_C + LOAD_PC0 + LOAD_PC1 + LOAD_IO + WRITE + WRITE_IO)
+
+// can step a and the step b that follows it run in the same clock
+static int can_merge(control_word a, control_word b)
+{
+	struct action da = decode_word(a), db = decode_word(b);
+
+	if((a | b) & LOAD_IR || da.contention || db.contention)
+		return 0;
+	if(da.bus != BUS_NONE && db.bus != BUS_NONE && da.bus != db.bus)
+		return 0;
+	int bus = da.bus != BUS_NONE ? da.bus : db.bus;
+	if(((a & BUS_LOADS) && da.bus != bus) || ((b & BUS_LOADS) && db.bus != bus))
+		return 0;
+	//ADD_INC is the carry in of whichever step runs the alu, it must not come from the other step's LOAD_IO
+	if(da.alu || db.alu)
+	{
+		control_word alu_word = da.alu ? a : b;
+		if(da.alu && db.alu && ((a ^ b) & (ALU2|ALU1|ALU0|ADD_INC)))
+			return 0;
+		if(((a | b) & ADD_INC) != (alu_word & ADD_INC))
+			return 0;
+	}
+	if(state_read(b) & state_written(a))
+		return 0;
+	if(state_written(a) & state_written(b))
+		return 0;
+	return 1;
+}
+
+// is a step the same under every condition value, *word is its word when it is
+static int invariant_word(const control_word *store, int base, int step, control_word *word)
+{
+	*word = store[base | step << 4];
+	for(int cond = 1; cond < 16; cond++)
+		if(store[base | step << 4 | cond] != *word)
+			return 0;
+	return 1;
+}
+
+static void set_step(struct generator *gen, int base, int step, control_word word, int used)
+{
+	for(int cond = 0; cond < 16; cond++)
+	{
+		int addr = base | step << 4 | cond;
+		gen->store[addr] = used ? word : FILL_WORD;
+		if(used)
+			gen->written[addr>>3] |= 1 << (addr&7);
+		else
+			gen->written[addr>>3] &= ~(1 << (addr&7));
+	}
+}
+
+// compact one opcode in place, returns the number of steps removed
+static int compact_opcode(struct generator *gen, int ir)
+{
+	control_word *store = gen->store;
+	int base = ir << 8;
+	uint16_t preds[16] = {0};
+	int merged = 0;
+
+	for(int step = 0; step < 16; step++)
+	{
+		if(!step_written(gen, base | step << 4))
+			continue;
+		for(int cond = 0; cond < 16; cond++)
+			preds[NEXT_STEP(store[base | step << 4 | cond])] |= 1 << step;
+	}
+
+	for(int changed = 1; changed; )
+	{
+		changed = 0;
+		for(int a = 3; a < 16; a++)
+		{
+			control_word wa, wb;
+			if(!step_written(gen, base | a << 4) || !invariant_word(store, base, a, &wa))
+				continue;
+			int b = NEXT_STEP(wa);
+			if(b < 3 || b == a || !step_written(gen, base | b << 4) || preds[b] != 1 << a)
+				continue;
+			if(!invariant_word(store, base, b, &wb) || !can_merge(wa, wb))
+				continue;
+
+			int after_b = NEXT_STEP(wb);
+			set_step(gen, base, a, ((wa | wb) & ~NS15) | FIELD(STEP0, after_b), 1);
+			set_step(gen, base, b, 0, 0);
+			preds[after_b] = (preds[after_b] & ~(1 << b)) | 1 << a;
+			preds[b] = 0;
+			merged++;
+			changed = 1;
+		}
+	}
+	if(!merged)
+		return 0;
+
+	//renumber what is left from S3 up so the freed slots end up at the top
+	int8_t new_step[16];
+	control_word words[16][16];
+	int used[16] = {0}, next = 3;
+	for(int step = 0; step < 16; step++)
+	{
+		new_step[step] = step < 3 ? step : -1;
+		if(step >= 3 && step_written(gen, base | step << 4))
+			new_step[step] = next++;
+	}
+	for(int step = 0; step < 16; step++)
+	{
+		if(new_step[step] < 0)
+			continue;
+		used[new_step[step]] = step_written(gen, base | step << 4);
+		for(int cond = 0; cond < 16; cond++)
+		{
+			control_word word = store[base | step << 4 | cond];
+			int target = NEXT_STEP(word);
+			if(new_step[target] >= 0)
+				word = (word & ~NS15) | FIELD(STEP0, new_step[target]);
+			words[new_step[step]][cond] = word;
+		}
+	}
+	for(int step = 0; step < 16; step++)
+		for(int cond = 0; cond < 16; cond++)
+		{
+			int addr = base | step << 4 | cond;
+			store[addr] = step < next ? words[step][cond] : FILL_WORD;
+			if(step < next && used[step])
+				gen->written[addr>>3] |= 1 << (addr&7);
+			else
+				gen->written[addr>>3] &= ~(1 << (addr&7));
+		}
+	return merged;
+}
+
+static uint32_t next_random(uint32_t *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+/*
+run one opcode from step start until back to S0 (S3 for the execute part, INT_ENTRY for the interrupt entry in opcode 00)
+from a random state on the old and the new control store and compare the resulting state, for every C/N/Z combination.
+returns 0 when some run differs
+*/
+static int check_equivalent(struct generator *gen, const control_word *before, const control_word *after, int ir, int start, struct cpu *check)
+{
+	struct cpu *cpu_before = &check[0], *cpu_after = &check[1];
+	uint32_t *seed = &gen->check_seed;
+
+	for(int trial = 0; trial < 8; trial++)
+	{
+		for(int flags = 0; flags < 16; flags += 2)
+		{
+			memset(cpu_before, 0, sizeof(*cpu_before));
+			for(int addr = 0; addr < EEPROM_SIZE; addr += 4)
+			{
+				uint32_t r = next_random(seed);
+				memcpy(&cpu_before->mem[addr], &r, 4);
+			}
+			for(int port = 0; port < 256; port++)
+				cpu_before->io[port] = next_random(seed);
+			cpu_before->pc = next_random(seed);
+			cpu_before->mar0 = next_random(seed);
+			cpu_before->mar1 = next_random(seed);
+			cpu_before->a = next_random(seed);
+			cpu_before->b = next_random(seed);
+			cpu_before->c = next_random(seed);
+			cpu_before->io_select = next_random(seed);
+			cpu_before->ir = ir;
+			cpu_before->flags = flags;
+			cpu_before->step = start;
+			cpu_before->current_op = -1;
+			*cpu_after = *cpu_before;
+
+			for(int n = 0; n < 32 && cpu_before->step != 0; n++)
+			{
+				struct action act = decode_word(before[ir << 8 | cpu_before->step << 4 | cpu_before->flags]);
+				execute_action(cpu_before, &act);
+			}
+			for(int n = 0; n < 32 && cpu_after->step != 0; n++)
+			{
+				struct action act = decode_word(after[ir << 8 | cpu_after->step << 4 | cpu_after->flags]);
+				execute_action(cpu_after, &act);
+			}
+			if(cpu_before->pc != cpu_after->pc || cpu_before->mar0 != cpu_after->mar0 || cpu_before->mar1 != cpu_after->mar1
+				|| cpu_before->a != cpu_after->a || cpu_before->b != cpu_after->b || cpu_before->c != cpu_after->c
+				|| cpu_before->ir != cpu_after->ir || cpu_before->io_select != cpu_after->io_select
+				|| cpu_before->flags != cpu_after->flags || cpu_before->step != cpu_after->step
+				|| memcmp(cpu_before->io, cpu_after->io, sizeof(cpu_before->io)) != 0
+				|| memcmp(cpu_before->mem, cpu_after->mem, sizeof(cpu_before->mem)) != 0)
+				return 0;
+		}
+	}
+	return 1;
+}
+
+// populated steps of one opcode
+static int count_steps(const struct generator *gen, int ir)
+{
+	int steps = 0;
+	for(int step = 0; step < 16; step++)
+		steps += step_written(gen, ir << 8 | step << 4);
+	return steps;
+}
+
+/*
+compaction over every opcode with a before/after report of its steps and cycles, each compacted opcode is checked
+on the emulator, opcode 00 from INT_ENTRY as well when the interrupt entry is in it.
+the report says so when nothing merged, the single bus leaves most neighbouring steps no room
+*/
+static int compact_control_store(struct generator *gen, int interrupts)
+{
+	control_word *before = malloc(sizeof(gen->store));
+	struct cpu *check = malloc(2 * sizeof(struct cpu));
+	int total_before = 0, total_after = 0, opcodes = 0, shown = 0, failed = 0;
+
+	if(before == NULL || check == NULL)
+	{
+		printf("out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(before, gen->store, sizeof(gen->store));
+	//-o asked for this report, it prints at every level: the compacted opcodes and the totals, -v -v adds the others
+	fprintf(gen->out, "compacting micro steps\n");
+	for(int ir = 0; ir < 256; ir++)
+	{
+		if(!step_written(gen, ir << 8))
+			continue;
+		int steps = count_steps(gen, ir), merged = compact_opcode(gen, ir);
+		const char *name = opcode_name(ir);
+		total_before += steps;
+		total_after += count_steps(gen, ir);
+		opcodes += merged > 0;
+		if(merged || gen->verbosity >= MC_LOG_DEBUG)
+		{
+			if(!shown++)
+				fprintf(gen->out, "  %-10s %-4s %6s %6s %8s %8s\n", "opcode", "ir", "steps", "after", "cycles", "after");
+			fprintf(gen->out, "  %-10s %02x   %6d %6d ", name ? name : "?", ir, steps, count_steps(gen, ir));
+			print_cycles(gen->out, instruction_cycles(before, ir, 0));
+			fprintf(gen->out, " ");
+			print_cycles(gen->out, instruction_cycles(gen->store, ir, 0));
+			fprintf(gen->out, "\n");
+		}
+		if(merged && (!check_equivalent(gen, before, gen->store, ir, 3, check)
+			|| (interrupts && ir == IR_OF(NOP) && !check_equivalent(gen, before, gen->store, ir, INT_ENTRY >> 4, check))))
+		{
+			gen_log(gen, MC_LOG_ERROR, "  %-10s %02x   compacted sequence does not match the original on the emulator\n", name ? name : "?", ir);
+			failed++;
+		}
+	}
+	fprintf(gen->out, "  %d populated steps before, %d after, %d opcode%s compacted\n", total_before, total_after, opcodes, opcodes == 1 ? "" : "s");
+	if(!opcodes)
+		fprintf(gen->out, "  no two neighbouring steps of these tables can share a clock on the single bus, the image is unchanged\n");
+	free(before);
+	free(check);
+	return failed;
+}
+
+/*
+fetch/execute overlap: the last step of an instruction (the one going to NS0) also does the first fetch steps of the next one
+when they can share the clock (can_merge), and goes on at the first fetch step left, so the next instruction enters at S1 or later.
+the fetch steps run with the old ir, so only the opcode's own S0-S2 have to be the standard fetch. with the interrupt
+dispatch (-i) the steps with I set still go to S0, where I is looked at.
+S0 is skipped, so this cannot go with FAST_FETCH (latched at S0)
+*/
+static void generate_overlap(struct generator *gen)
+{
+	control_word *store = gen->store;
+	int total = 0;
+
+	gen_log(gen, MC_LOG_INFO, "overlapping the fetch with the last execute step\n");
+	for(int ir = 0; ir < 256; ir++)
+	{
+		int base = ir << 8, merged = 0;
+		unsigned standard = 0; //condition values with the plain fetch, not the interrupt dispatch (-i)
+		if(!step_written(gen, base))
+			continue;
+		for(int cond = 0; cond < 16; cond++)
+			if(store[base | S0 | cond] == NS1 + FETCH_SIGNALS && store[base | S1 | cond] == NS2 + PC1_FETCH_SIGNALS + INCR_PC
+				&& store[base | S2 | cond] == NS3 + GATE_MEM + LOAD_IR)
+				standard |= 1 << cond;
+		if(!standard)
+			continue;
+		int before_taken = instruction_cycles(store, ir, C|N|Z), before = instruction_cycles(store, ir, 0);
+
+		for(int step = 3; step < 16; step++)
+			for(int cond = 0; cond < 16; cond++)
+			{
+				int addr = base | step << 4 | cond;
+				control_word word = store[addr];
+				if(!(standard >> cond & 1) || !step_written(gen, addr) || NEXT_STEP(word) != 0)
+					continue;
+				int next = 0;
+				//the fetch steps before LOAD_IR, as long as each one fits in the same clock
+				while(next < 2 && can_merge(word, store[base | next << 4 | cond]))
+				{
+					control_word fetch = store[base | next << 4 | cond];
+					next = NEXT_STEP(fetch);
+					word = ((word | fetch) & ~NS15) | FIELD(STEP0, next);
+				}
+				if(next)
+				{
+					store[addr] = word;
+					merged++;
+				}
+			}
+		if(!merged)
+			continue;
+		total += merged;
+		const char *name = opcode_name(ir);
+		gen_log(gen, MC_LOG_DEBUG, "  %-10s %02x  cycles %d -> %d", name ? name : "?", ir, before, instruction_cycles(store, ir, 0));
+		if(is_conditional_jump(ir))
+			gen_log(gen, MC_LOG_DEBUG, ", taken %d -> %d", before_taken, instruction_cycles(store, ir, C|N|Z));
+		gen_log(gen, MC_LOG_DEBUG, "\n");
+	}
+	gen_log(gen, MC_LOG_INFO, "  %d last step%s overlapped, the others need the bus the fetch uses\n", total, total == 1 ? "" : "s");
+}
+
+// build, check, add interrupts, compact and fast fetch or overlap one control store, returns 0 when an image can be written
+static int generate(struct generator *gen, const struct microcode_def *def, int compact, int fast_fetch, int overlap, int interrupts)
+{
+	build_control_store(gen, def);
+	if(gen->conflicts)
+	{
+		gen_log(gen, MC_LOG_ERROR, "%d conflicting writes in the micro code table, no image generated\n", gen->conflicts);
+		return 1;
+	}
+	if(interrupts && generate_interrupts(gen))
+	{
+		gen_log(gen, MC_LOG_ERROR, "the interrupt entry or RTI lands on micro code the tables already use, no image generated\n");
+		return 1;
+	}
+	check_step_graph(gen);
+	if(compact && compact_control_store(gen, interrupts))
+	{
+		gen_log(gen, MC_LOG_ERROR, "compaction changed the behaviour of the micro code, no image generated\n");
+		return 1;
+	}
+	if(fast_fetch && overlap)
+	{
+		gen_log(gen, MC_LOG_ERROR, "FAST_FETCH is latched at S0, which the overlap skips, use one or the other\n");
+		return 1;
+	}
+	if(fast_fetch)
+		generate_fast_fetch(gen);
+	if(gen->conflicts)
+	{
+		gen_log(gen, MC_LOG_ERROR, "the FAST_FETCH forms do not fit the tables, no image generated\n");
+		return 1;
+	}
+	if(overlap)
+		generate_overlap(gen);
+	return 0;
+}
+
+/*
+arena and control store, the library entry points of microcode.h
+*/
+#define ARENA_ALIGN 64 //cache line, the planes are walked with vector loads
+
+void arena_init(struct arena *arena, size_t size)
+{
+	arena->base = malloc(size);
+	arena->size = size;
+	arena->used = 0;
+	if(arena->base == NULL)
+	{
+		printf("out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	size_t at = (arena->used + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+	if(at > arena->size || size > arena->size - at)
+		return NULL;
+	arena->used = at + size;
+	return arena->base + at;
+}
+
+void arena_reset(struct arena *arena)
+{
+	arena->used = 0;
+}
+
+void arena_free(struct arena *arena)
+{
+	free(arena->base);
+	arena->base = NULL;
+	arena->size = arena->used = 0;
+}
+
+size_t control_store_footprint(void)
+{
+	return sizeof(struct control_store) + sizeof(struct generator) + CONTROL_CHIPS * EEPROM_SIZE + 3 * ARENA_ALIGN;
+}
+
+struct control_store *build_microcode(struct arena *arena, const struct microcode_def *def, const struct build_options *options)
+{
+	size_t mark = arena->used;
+	struct control_store *cs = arena_alloc(arena, sizeof(*cs));
+	struct generator *gen = arena_alloc(arena, sizeof(*gen));
+	uint8_t (*planes)[EEPROM_SIZE] = arena_alloc(arena, CONTROL_CHIPS * EEPROM_SIZE);
+	FILE *out = options->out ? options->out : stdout;
+
+	if(cs == NULL || gen == NULL || planes == NULL)
+	{
+		fprintf(out, "arena too small for a control store (%zu byte)\n", control_store_footprint());
+		arena->used = mark;
+		return NULL;
+	}
+	init_generator(gen, out, options->verbosity);
+	if(generate(gen, def, options->compact, options->fast_fetch, options->overlap, options->interrupts))
+	{
+		arena->used = mark;
+		return NULL;
+	}
+	split_planes(gen->store, planes);
+	*cs = (struct control_store){gen->store, gen->written, planes};
+	return cs;
+}
+
+struct control_store *load_chip_images(struct arena *arena)
+{
+	size_t mark = arena->used;
+	struct control_store *cs = arena_alloc(arena, sizeof(*cs));
+	control_word *words = arena_alloc(arena, EEPROM_SIZE * sizeof(control_word));
+	uint8_t (*planes)[EEPROM_SIZE] = arena_alloc(arena, CONTROL_CHIPS * EEPROM_SIZE);
+
+	if(cs == NULL || words == NULL || planes == NULL)
+	{
+		printf("arena too small for a control store (%zu byte)\n", control_store_footprint());
+		arena->used = mark;
+		return NULL;
+	}
+	load_control_store(words, planes);
+	*cs = (struct control_store){words, NULL, planes};
+	return cs;
+}
+
+struct word_span control_words(const struct control_store *cs)
+{
+	return (struct word_span){cs->words, EEPROM_SIZE};
+}
+
+struct byte_span chip_plane(const struct control_store *cs, int chip)
+{
+	if(chip < 0 || chip >= CONTROL_CHIPS)
+		return (struct byte_span){NULL, 0};
+	return (struct byte_span){cs->planes[chip], EEPROM_SIZE};
+}
+
+const uint8_t *occupancy(const struct control_store *cs)
+{
+	return cs->written;
+}
+
+/*
+benchmark and golden images (-B, -G).
+
+the benchmark times the expansion of the tables, the whole generation (with -o -f for the built in tables, the
+most work the passes do), the split into chip planes and the write of the images, for the built in tables and for
+a synthetic table with every opcode slot, step and condition filled (the expansion upper bound).
+the golden check hashes the chip images of a fixed set of variants and compares them with the hashes recorded
+below, any change to the expansion or output path that changes a single byte shows up there. the built in tables
+have no pair of steps -o can merge, so the compaction pass is checked on compact_list below
+*/
+#define BENCH_PHASES 4
+
+static const char *bench_phase_names[BENCH_PHASES] = {"expand", "generate", "planes", "write"};
+
+// one entry per opcode slot and step, a different word everywhere, the branch steps the generator writes itself are left out
+static struct micro_code *synthetic_table(void)
+{
+	struct micro_code *list = malloc((256 * 16 + 1) * sizeof(*list));
+	uint32_t seed = 0x9E3779B9;
+	int count = 0;
+
+	if(list == NULL)
+	{
+		printf("out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	for(int ir = 0; ir < 256; ir++)
+		for(int step = 0; step < 16; step++)
+		{
+			if((ir & 0xF8) == IR_OF(JMP) && (ir & 7) && step == 3)
+				continue;
+			control_word word = (next_random(&seed) | (control_word) next_random(&seed) << 32) & CONTROL_MASK & ~NS15;
+			list[count++] = (struct micro_code){ir << 8 | step << 4, word | FIELD(STEP0, (step + 1) & 15), 0};
+		}
+	list[count] = (struct micro_code){-1, 0, 0};
+	return list;
+}
+
+/*
+one opcode (ir e0, a free slot) that -o compacts, the coverage of the compaction pass: S3+S4 and S7+S8 share a clock,
+11 steps become 9. S8 -> S9 is the pair only the dependency check keeps apart (S9 gates the pc S8 increments),
+check_broken_merge() merges it anyway and expects the equivalence run to catch it
+*/
+#define COMPACT_OP 0xE000
+
+static struct micro_code compact_list[] = {
+	{COMPACT_OP+S0, NS1 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{COMPACT_OP+S1, NS2 + LOAD_MAR1 + GATE_PC1 + INCR_PC, CARE_DEFAULT},
+	{COMPACT_OP+S2, NS3 + GATE_MEM + LOAD_IR, CARE_DEFAULT},
+	{COMPACT_OP+S3, NS4 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},
+	{COMPACT_OP+S4, NS5 + INCR_PC, CARE_DEFAULT},                 //merges into S3, the pc is only gated there
+	{COMPACT_OP+S5, NS6 + LOAD_MAR1 + GATE_PC1, CARE_DEFAULT},
+	{COMPACT_OP+S6, NS7 + GATE_MEM + LOAD_A, CARE_DEFAULT},       //reads the MAR S5 loads, and another bus source
+	{COMPACT_OP+S7, NS8 + LOAD_B + GATE_C, CARE_DEFAULT},
+	{COMPACT_OP+S8, NS9 + INCR_PC, CARE_DEFAULT},                 //merges into S7
+	{COMPACT_OP+S9, NS10 + LOAD_MAR0 + GATE_PC0, CARE_DEFAULT},   //needs the pc S8 increments
+	{COMPACT_OP+S10, NS0 + ALU_ADD + LOAD_C, CARE_DEFAULT},
+	{-1, 0, 0}
+};
+
+static struct micro_code no_jumps[] = {{-1, 0, 0}};
+static const struct microcode_def compact_def = {"compaction", compact_list, no_jumps};
+
+/*
+force the S8+S9 merge the dependency check refuses and run the equivalence check on it, returns 0 when both the
+dependency check and the equivalence run reject it, the generator reports go to sink
+*/
+static int check_broken_merge(FILE *sink)
+{
+	struct generator *gen = malloc(sizeof(*gen));
+	control_word *broken = malloc(EEPROM_SIZE * sizeof(control_word));
+	struct cpu *check = malloc(2 * sizeof(struct cpu));
+	int ir = IR_OF(COMPACT_OP), failed = 0;
+
+	if(gen == NULL || broken == NULL || check == NULL)
+	{
+		printf("out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	init_generator(gen, sink, 0);
+	build_control_store(gen, &compact_def);
+	memcpy(broken, gen->store, EEPROM_SIZE * sizeof(control_word));
+
+	control_word s8 = gen->store[COMPACT_OP | S8], s9 = gen->store[COMPACT_OP | S9];
+	if(can_merge(s8, s9))
+	{
+		printf("  the dependency check lets S9 share a clock with the S8 it depends on\n");
+		failed++;
+	}
+	for(int cond = 0; cond < 16; cond++)
+	{
+		broken[COMPACT_OP | S8 | cond] = ((s8 | s9) & ~NS15) | FIELD(STEP0, NEXT_STEP(s9));
+		broken[COMPACT_OP | S9 | cond] = FILL_WORD;
+	}
+	if(check_equivalent(gen, gen->store, broken, ir, 3, check))
+	{
+		printf("  the equivalence run does not see the forced S8+S9 merge\n");
+		failed++;
+	}
+	printf("  %-14s %s\n", "broken merge", failed ? "NOT CAUGHT" : "caught");
+	free(gen);
+	free(broken);
+	free(check);
+	return failed;
+}
+
+static uint64_t hash_image(const uint8_t *image, size_t size)
+{
+	uint64_t hash = 14695981039346656037u;
+	for(size_t i = 0; i < size; i++)
+		hash = (hash ^ image[i]) * 1099511628211u;
+	return hash;
+}
+
+static int by_time(const void *x, const void *y)
+{
+	double a = *(const double *) x, b = *(const double *) y;
+	return (a > b) - (a < b);
+}
+
+// the expand rate is of the addresses build_control_store writes, the write phase writes the chip files and the word table into dir
+static void bench_table(const char *name, const struct microcode_def *def, int compact, int fast_fetch, int runs,
+	struct generator *gen, uint8_t planes[][EEPROM_SIZE], FILE *sink, const char *dir)
+{
+	double *times = malloc(BENCH_PHASES * runs * sizeof(double));
+	struct timespec t0, t1;
+	int expanded = 0, written = 0;
+	char path[256];
+
+	if(times == NULL)
+	{
+		printf("out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	for(int run = 0; run < runs; run++)
+	{
+		init_generator(gen, sink, 0);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		build_control_store(gen, def);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		times[0 * runs + run] = elapsed_ms(t0, t1);
+		if(run == 0)
+			for(int addr = 0; addr < EEPROM_SIZE; addr++)
+				expanded += step_written(gen, addr);
+
+		init_generator(gen, sink, 0);
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		if(generate(gen, def, compact, fast_fetch, 0, 0))
+		{
+			printf("%s: the table does not generate\n", name);
+			exit(EXIT_FAILURE);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		times[1 * runs + run] = elapsed_ms(t0, t1);
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		split_planes(gen->store, planes);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		times[2 * runs + run] = elapsed_ms(t0, t1);
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+		{
+			snprintf(path, sizeof(path), "%s/chip%d.bin", dir, chip);
+			write_file(path, planes[chip], EEPROM_SIZE);
+		}
+		snprintf(path, sizeof(path), "%s/control_store.bin", dir);
+		write_file(path, gen->store, EEPROM_SIZE * sizeof(control_word));
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		times[3 * runs + run] = elapsed_ms(t0, t1);
+	}
+	for(int addr = 0; addr < EEPROM_SIZE; addr++)
+		written += step_written(gen, addr);
+
+	printf("%s: %d addresses expanded, %d written%s\n", name, expanded, written, compact || fast_fetch ? " after -o -f" : "");
+	for(int phase = 0; phase < BENCH_PHASES; phase++)
+	{
+		double *t = times + phase * runs;
+		qsort(t, runs, sizeof(double), by_time);
+		printf("  %-10s best %8.3f ms  median %8.3f ms", bench_phase_names[phase], t[0], t[runs / 2]);
+		if(phase == 0)
+			printf("  %6.1f M addresses/s", expanded / t[runs / 2] / 1000.0);
+		printf("\n");
+	}
+	free(times);
+}
+
+// time every phase runs times, the median is the baseline to compare against
+int run_benchmark(int runs)
+{
+	struct arena arena;
+	struct microcode_def synthetic = {"synthetic", synthetic_table(), (struct micro_code[]){{-1, 0, 0}}};
+	FILE *sink = fopen("/dev/null", "w");
+	char dir[] = "/tmp/mc_bench.XXXXXX", path[256];
+
+	arena_init(&arena, control_store_footprint());
+	struct generator *gen = arena_alloc(&arena, sizeof(*gen));
+	uint8_t (*planes)[EEPROM_SIZE] = arena_alloc(&arena, CONTROL_CHIPS * EEPROM_SIZE);
+	if(sink == NULL || gen == NULL || planes == NULL)
+	{
+		printf("Unable to open file /dev/null.\n");
+		exit(EXIT_FAILURE);
+	}
+	if(mkdtemp(dir) == NULL)
+	{
+		printf("Unable to create directory %s.\n", dir);
+		exit(EXIT_FAILURE);
+	}
+	if(runs < 1)
+		runs = 1;
+	printf("benchmark, %d runs of every phase, files written to %s\n", runs, dir);
+	bench_table("built in", &builtin_def, 1, 1, runs, gen, planes, sink, dir);
+	bench_table("synthetic", &synthetic, 0, 0, runs, gen, planes, sink, dir);
+
+	for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+	{
+		snprintf(path, sizeof(path), "%s/chip%d.bin", dir, chip);
+		unlink(path);
+	}
+	snprintf(path, sizeof(path), "%s/control_store.bin", dir);
+	unlink(path);
+	rmdir(dir);
+	fclose(sink);
+	free(synthetic.list);
+	arena_free(&arena);
+	return 0;
+}
+
+enum golden_table{
+	GOLDEN_BUILTIN,
+	GOLDEN_SYNTHETIC,
+	GOLDEN_COMPACTION, //compact_def, steps is the populated steps of its opcode
+};
+
+static const struct golden{
+	const char *name;
+	int table, compact, fast_fetch, overlap, interrupts;
+	uint64_t hash[3]; //chip0..chip2, fnv-1a 64
+	int steps;
+} golden_images[] = {
+	{"builtin",       GOLDEN_BUILTIN,    0, 0, 0, 0, {0xf6998ace3f694a35u, 0xe3ec62ea89ddc695u, 0x4a894aaa74031395u}, 0},
+	{"-f",            GOLDEN_BUILTIN,    0, 1, 0, 0, {0xa42f865f54162405u, 0xb91135dae9504285u, 0x404de4bd4c9389e5u}, 0},
+	{"-O",            GOLDEN_BUILTIN,    0, 0, 1, 0, {0x7de4cd13c84fccf5u, 0xe3ec62ea89ddc695u, 0xe51ae73a814b0335u}, 0},
+	{"-i",            GOLDEN_BUILTIN,    0, 0, 0, 1, {0xb2ac4865d6083f75u, 0x602b333ec7167495u, 0xd174050d91bb8075u}, 0},
+	{"-i -f",         GOLDEN_BUILTIN,    0, 1, 0, 1, {0xacb08c80aa222ec5u, 0x8d2cc21811792d85u, 0x6914025900389245u}, 0},
+	{"-i -O",         GOLDEN_BUILTIN,    0, 0, 1, 1, {0x8970ba39e7bb0095u, 0x602b333ec7167495u, 0xf6109333992ef63du}, 0},
+	{"synthetic",     GOLDEN_SYNTHETIC,  0, 0, 0, 0, {0x6df7f617f9934e45u, 0x229caeb2d0968725u, 0x3190535d3350b855u}, 0},
+	{"compaction",    GOLDEN_COMPACTION, 0, 0, 0, 0, {0xd4774a1419531865u, 0xfc6aeed410d769e5u, 0x5b19698cea1bcdc5u}, 11},
+	{"compaction -o", GOLDEN_COMPACTION, 1, 0, 0, 0, {0x7b608438bce35865u, 0x38fc108d63189fe5u, 0x1156ede61b727cc5u}, 9},
+};
+
+/*
+regenerate every golden variant and compare the image hashes (and the steps left by the compaction), then check that
+a merge breaking a dependency is caught. returns the number of failures.
+the hashes are of the 3 chip layout, another CONTROL_CHIPS has nothing to compare with
+*/
+int check_golden(void)
+{
+	struct arena arena;
+	struct microcode_def synthetic = {"synthetic", synthetic_table(), (struct micro_code[]){{-1, 0, 0}}};
+	FILE *sink = fopen("/dev/null", "w");
+	int failed = 0;
+
+	if(CONTROL_CHIPS != 3)
+	{
+		printf("golden images are recorded for 3 control chips, this build has %d\n", CONTROL_CHIPS);
+		free(synthetic.list);
+		if(sink)
+			fclose(sink);
+		return 1;
+	}
+	if(sink == NULL)
+	{
+		printf("Unable to open file /dev/null.\n");
+		exit(EXIT_FAILURE);
+	}
+	arena_init(&arena, control_store_footprint());
+	printf("golden images\n");
+	for(size_t i = 0; i < sizeof(golden_images) / sizeof(golden_images[0]); i++)
+	{
+		const struct golden *g = &golden_images[i];
+		struct build_options options = {g->compact, g->fast_fetch, g->overlap, g->interrupts, 0, sink};
+		int differ = 0;
+
+		arena_reset(&arena);
+		const struct microcode_def *def = g->table == GOLDEN_SYNTHETIC ? &synthetic
+			: g->table == GOLDEN_COMPACTION ? &compact_def : &builtin_def;
+		struct control_store *cs = build_microcode(&arena, def, &options);
+		printf("  %-14s", g->name);
+		for(int chip = 0; chip < 3; chip++)
+		{
+			uint64_t hash = cs ? hash_image(cs->planes[chip], EEPROM_SIZE) : 0;
+			printf(" 0x%016llxu,", (unsigned long long) hash);
+			differ |= hash != g->hash[chip];
+		}
+		if(cs && g->steps)
+		{
+			int steps = 0;
+			for(int step = 0; step < 16; step++)
+				steps += cs->written[(COMPACT_OP | step << 4) >> 3] & 1;
+			printf(" %d steps", steps);
+			differ |= steps != g->steps;
+		}
+		printf(" %s\n", !cs ? "FAILED to generate" : differ ? "DIFFERS" : "ok");
+		if(differ)
+		{
+			printf("  %-14s", "expected");
+			for(int chip = 0; chip < 3; chip++)
+				printf(" 0x%016llxu,", (unsigned long long) g->hash[chip]);
+			printf("\n");
+		}
+		failed += differ;
+	}
+	printf("%d of %d variants match\n", (int) (sizeof(golden_images) / sizeof(golden_images[0])) - failed,
+		(int) (sizeof(golden_images) / sizeof(golden_images[0])));
+	failed += check_broken_merge(sink);
+	fclose(sink);
+	free(synthetic.list);
+	arena_free(&arena);
+	return failed;
+}
+
+/*
+batch mode: build many variants at once, each into its own output directory.
+the variant file has one line per variant, "output_dir definition [-o] [-i] [-f|-O]", the definition being a .def file
+or "builtin" for the compiled in tables. the report of every variant goes to output_dir/build.log
+*/
+struct variant{
+	char dir[256];
+	char definition[256];
+	int compact;
+	int fast_fetch;
+	int overlap;
+	int interrupts;
+	int failed;
+	double ms;
+};
+
+static struct variant *read_variants(const char *file_name, int *count)
+{
+	char line[1024];
+	struct variant *variants = NULL;
+	int capacity = 0, line_no = 0;
+
+	FILE *fPtr = fopen(file_name, "r");
+	if(fPtr == NULL)
+	{
+		printf("Unable to open file %s.\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	*count = 0;
+	while(fgets(line, sizeof(line), fPtr))
+	{
+		char *rest = line, *token;
+		struct variant v = {0};
+
+		line_no++;
+		line[strcspn(line, "#\r\n")] = 0;
+		if((token = strtok_r(rest, " \t", &rest)) == NULL)
+			continue;
+		snprintf(v.dir, sizeof(v.dir), "%s", token);
+		if((token = strtok_r(NULL, " \t", &rest)) == NULL)
+		{
+			printf("%s:%d: expected \"output_dir definition [-o] [-i] [-f|-O]\"\n", file_name, line_no);
+			exit(EXIT_FAILURE);
+		}
+		snprintf(v.definition, sizeof(v.definition), "%s", token);
+		while((token = strtok_r(NULL, " \t", &rest)) != NULL)
+		{
+			if(strcmp(token, "-o") == 0)
+				v.compact = 1;
+			else if(strcmp(token, "-f") == 0)
+				v.fast_fetch = 1;
+			else if(strcmp(token, "-O") == 0)
+				v.overlap = 1;
+			else if(strcmp(token, "-i") == 0)
+				v.interrupts = 1;
+			else
+			{
+				printf("%s:%d: unknown variant option '%s'\n", file_name, line_no, token);
+				exit(EXIT_FAILURE);
+			}
+		}
+		if(*count == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 64;
+			variants = realloc(variants, capacity * sizeof(*variants));
+			if(variants == NULL)
+			{
+				printf("out of memory\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		variants[(*count)++] = v;
+	}
+	fclose(fPtr);
+	return variants;
+}
+
+// everything a variant needs is in gen and planes, so any number of these run at the same time
+static void build_variant(struct variant *v, struct arena *arena)
+{
+	struct microcode_def def = builtin_def;
+	struct timespec t_start, t_end;
+	char path[300];
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	v->failed = 1;
+	if(mkdir(v->dir, 0777) != 0 && errno != EEXIST)
+	{
+		printf("Unable to create directory %s.\n", v->dir);
+		return;
+	}
+	snprintf(path, sizeof(path), "%s/build.log", v->dir);
+	FILE *log = fopen(path, "w");
+	if(log == NULL)
+	{
+		printf("Unable to create file %s.\n", path);
+		return;
+	}
+	struct build_options options = {v->compact, v->fast_fetch, v->overlap, v->interrupts, MC_LOG_DEBUG, log};
+	int loaded = strcmp(v->definition, "builtin") != 0;
+	if(!loaded || load_definition(v->definition, &def, log) == 0)
+	{
+		struct control_store *cs;
+		arena_reset(arena);
+		if((cs = build_microcode(arena, &def, &options)) != NULL)
+		{
+			for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+			{
+				snprintf(path, sizeof(path), "%s/chip%d.bin", v->dir, chip);
+				write_file(path, cs->planes[chip], EEPROM_SIZE);
+			}
+			snprintf(path, sizeof(path), "%s/control_store.bin", v->dir);
+			write_file(path, cs->words, EEPROM_SIZE * sizeof(control_word));
+			v->failed = 0;
+		}
+		if(loaded)
+			free_definition(&def);
+	}
+	fclose(log);
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+	v->ms = elapsed_ms(t_start, t_end);
+}
+
+//one deque per worker: the owner takes from the bottom, a worker whose deque ran dry steals from the top of the others
+struct job_queue{
+	pthread_mutex_t lock;
+	int *jobs;
+	int top, bottom; //jobs[top..bottom) are left to do
+};
+
+struct pool{
+	struct job_queue *queues;
+	int workers;
+	struct variant *variants;
+};
+
+struct worker{
+	struct pool *pool;
+	int id;
+};
+
+static int take_job(struct job_queue *queue, int steal)
+{
+	int job = -1;
+
+	pthread_mutex_lock(&queue->lock);
+	if(queue->top < queue->bottom)
+		job = steal ? queue->jobs[queue->top++] : queue->jobs[--queue->bottom];
+	pthread_mutex_unlock(&queue->lock);
+	return job;
+}
+
+static void *worker_main(void *arg)
+{
+	struct worker *self = arg;
+	struct pool *pool = self->pool;
+	struct arena arena;
+
+	arena_init(&arena, control_store_footprint());
+	for(;;)
+	{
+		int job = take_job(&pool->queues[self->id], 0);
+		for(int k = 1; job < 0 && k < pool->workers; k++)
+			job = take_job(&pool->queues[(self->id + k) % pool->workers], 1);
+		if(job < 0)
+			break; //nothing is queued once the pool runs, so every deque empty means done
+		build_variant(&pool->variants[job], &arena);
+	}
+	arena_free(&arena);
+	return NULL;
+}
+
+int run_batch(const char *file_name, int workers)
+{
+	struct timespec t_start, t_end;
+	int count, failed = 0;
+	double busy = 0;
+
+	struct variant *variants = read_variants(file_name, &count);
+	if(count == 0)
+	{
+		printf("%s: no variants\n", file_name);
+		return EXIT_FAILURE;
+	}
+	if(workers > count)
+		workers = count;
+
+	struct pool pool = {calloc(workers, sizeof(struct job_queue)), workers, variants};
+	pthread_t *threads = calloc(workers, sizeof(pthread_t));
+	struct worker *self = calloc(workers, sizeof(struct worker));
+	if(pool.queues == NULL || threads == NULL || self == NULL)
+	{
+		printf("out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	for(int w = 0; w < workers; w++)
+	{
+		struct job_queue *queue = &pool.queues[w];
+		pthread_mutex_init(&queue->lock, NULL);
+		queue->jobs = malloc(count * sizeof(int));
+		for(int job = w; job < count; job += workers) //round robin, the stealing evens out variants of different cost
+			queue->jobs[queue->bottom++] = job;
+	}
+
+	printf("building %d variants on %d threads\n", count, workers);
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	for(int w = 0; w < workers; w++)
+	{
+		self[w] = (struct worker){&pool, w};
+		if(pthread_create(&threads[w], NULL, worker_main, &self[w]) != 0)
+		{
+			printf("unable to start worker thread %d\n", w);
+			exit(EXIT_FAILURE);
+		}
+	}
+	for(int w = 0; w < workers; w++)
+		pthread_join(threads[w], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+	for(int i = 0; i < count; i++)
+	{
+		printf("  %-24s %-24s %s%s%s %-6s %8.3f ms\n", variants[i].dir, variants[i].definition,
+			variants[i].compact ? "-o" : "  ", variants[i].interrupts ? " -i" : "   ", variants[i].fast_fetch ? " -f" : variants[i].overlap ? " -O" : "   ",
+			variants[i].failed ? "FAILED" : "ok", variants[i].ms);
+		failed += variants[i].failed;
+		busy += variants[i].ms;
+	}
+	printf("%d built, %d failed (see build.log in their directory)\n", count - failed, failed);
+	printf("batch: %.3f ms wall, %.3f ms of build time\n", elapsed_ms(t_start, t_end), busy);
+
+	for(int w = 0; w < workers; w++)
+	{
+		pthread_mutex_destroy(&pool.queues[w].lock);
+		free(pool.queues[w].jobs);
+	}
+	free(pool.queues);
+	free(threads);
+	free(self);
+	free(variants);
+	return failed ? EXIT_FAILURE : 0;
+}
+
+/*
+verify the dumped eeprom contents against the images the generator produces.
+
+the dumps are mapped and compared a 16 byte row at a time, one row is every condition of one step,
+so the compare mask of a row is directly the set of conditions that differ.
+mismatches are grouped by opcode and step and decoded back to the table entry and the signal names
+*/
+static unsigned row_mismatch(const uint8_t *a, const uint8_t *b)
+{
+#ifdef __SSE2__
+	__m128i same = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) a), _mm_loadu_si128((const __m128i *) b));
+	return ~_mm_movemask_epi8(same) & 0xFFFF;
+#else
+	unsigned mask = 0;
+	for(int i = 0; i < 16; i++)
+		mask |= (unsigned) (a[i] != b[i]) << i;
+	return mask;
+#endif
+}
+
+// the table entry that writes addr, "filler" when none does
+static void print_source(FILE *out, const struct microcode_def *def, int addr, control_word word, int interrupts)
+{
+	const char *table;
+	int index;
+
+	if(interrupts && word == INT_DISPATCH && (addr & (S15 | I)) == I)
+	{
+		fprintf(out, "interrupt dispatch");
+		return;
+	}
+	if(FAST_FETCH_ROUTED(addr >> 8) && (addr & FAST_FETCH))
+	{
+		fprintf(out, "fast fetch");
+		return;
+	}
+	const struct micro_code *entry = find_entry(def, addr, interrupts, &table, &index);
+
+	if(entry)
+		fprintf(out, "%s[%d]%s", table, index, entry->output != word ? " (rewritten)" : "");
+	else if(table)
+		fprintf(out, "%s %d", table, index);
+	else
+		fprintf(out, word == FILL_WORD ? "filler" : "derived");
+}
+
+static void print_bits(FILE *out, control_word mask)
+{
+	for(int bit = CONTROL_BITS - 1; bit >= 0; bit--)
+		if(mask >> bit & 1)
+			fprintf(out, " %s", control_bit_names[bit] ? control_bit_names[bit] : "?");
+}
+
+static control_word dumped_word(const uint8_t *const dump[], int addr)
+{
+	control_word word = 0;
+	for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+		word |= (control_word) dump[chip][addr] << (8 * chip);
+	return word;
+}
+
+/*
+compare prefix0.bin..prefixN.bin with the chip images of cs.
+returns the number of addresses that differ, any unreadable dump is fatal
+*/
+int verify_dumps(const char *prefix, const struct control_store *cs, const struct microcode_def *def, int interrupts)
+{
+	uint8_t (*planes)[EEPROM_SIZE] = cs->planes;
+	const control_word *store = cs->words;
+	uint16_t differ[EEPROM_SIZE / 16];   //per row, the conditions that differ on any chip
+	const uint8_t *dump[CONTROL_CHIPS];
+	int fds[CONTROL_CHIPS];
+	int rows = 0, addresses = 0, shown = 0;
+	struct timespec t_start, t_done;
+
+	for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+	{
+		char file_name[256];
+		struct stat st;
+		snprintf(file_name, sizeof(file_name), "%s%d.bin", prefix, chip);
+		fds[chip] = open(file_name, O_RDONLY);
+		if(fds[chip] < 0 || fstat(fds[chip], &st) != 0)
+		{
+			printf("Unable to open file %s.\n", file_name);
+			exit(EXIT_FAILURE);
+		}
+		if(st.st_size != EEPROM_SIZE)
+		{
+			printf("%s is not a %d byte image\n", file_name, EEPROM_SIZE);
+			exit(EXIT_FAILURE);
+		}
+		dump[chip] = mmap(NULL, EEPROM_SIZE, PROT_READ, MAP_PRIVATE, fds[chip], 0);
+		if(dump[chip] == MAP_FAILED)
+		{
+			printf("oh no, the read failed for %s!!!\n", file_name);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	for(int row = 0; row < EEPROM_SIZE / 16; row++)
+	{
+		int addr = row * 16;
+		unsigned mask = 0;
+		for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+			mask |= row_mismatch(planes[chip] + addr, dump[chip] + addr);
+		differ[row] = (uint16_t) mask;
+		if(differ[row])
+		{
+			rows++;
+			addresses += count_bits(differ[row]);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t_done);
+
+	if(!addresses)
+		printf("verify: %s0.bin..%s%d.bin match (%.3f ms)\n", prefix, prefix, CONTROL_CHIPS - 1, elapsed_ms(t_start, t_done));
+	else
+		printf("verify: %d addresses in %d steps differ (%.3f ms)\n", addresses, rows, elapsed_ms(t_start, t_done));
+
+	//one line per opcode, step and control word pair, listing the conditions it covers
+	for(int row = 0; row < EEPROM_SIZE / 16 && shown < 64; row++)
+	{
+		unsigned left = differ[row];
+		while(left && shown < 64)
+		{
+			int first = __builtin_ctz(left), addr = row * 16 + first;
+			control_word expected = store[addr];
+			control_word got = dumped_word(dump, addr);
+			char label[16];
+			unsigned chips = 0;
+
+			printf("  %-10s ir %02x S%-2d cond", step_opcode_name(row >> 4, label, sizeof(label)), row >> 4, row & 15);
+			for(int cond = first; cond < 16; cond++)
+			{
+				int a = row * 16 + cond;
+				if(!(left & 1u << cond) || store[a] != expected
+					|| dumped_word(dump, a) != got)
+					continue;
+				printf(" %x", cond);
+				left &= ~(1u << cond);
+			}
+			printf("  ");
+			print_source(stdout, def, addr, expected, interrupts);
+			for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+				if(((expected ^ got) >> (chip * 8)) & 0xFF)
+					chips |= 1u << chip;
+			printf("\n    expected ");
+			print_signals(stdout, expected);
+			printf("\n    read     ");
+			print_signals(stdout, got);
+			printf("\n    chip%s", chips & (chips - 1) ? "s" : "");
+			for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+				if(chips & 1u << chip)
+					printf(" %d", chip);
+			if(expected & ~got)
+			{
+				printf(", missing");
+				print_bits(stdout, expected & ~got);
+			}
+			if(got & ~expected)
+			{
+				printf(", extra");
+				print_bits(stdout, got & ~expected);
+			}
+			printf("\n");
+			shown++;
+		}
+	}
+	if(shown == 64 && addresses)
+		printf("  ... more differences not shown\n");
+
+	for(int chip = 0; chip < CONTROL_CHIPS; chip++)
+	{
+		munmap((void *) dump[chip], EEPROM_SIZE);
+		close(fds[chip]);
+	}
+	return addresses;
+}
+
+/*
+listing of the control store for reading it by eye: one line per micro step and group of condition values that share
+a word, instead of one line per address. the conditions are the address bits ZNCI, "-" for either value, a group that
+is no cube of those is listed as its condition values
+*/
+static void format_conditions(char *text, unsigned set)
+{
+	unsigned all = 0xF, any = 0;
+
+	for(int cond = 0; cond < 16; cond++)
+		if(set >> cond & 1)
+			all &= cond, any |= cond;
+	unsigned free_bits = all ^ any;
+	int cube = count_bits(set) == 1 << count_bits(free_bits);
+	for(int cond = 0; cube && cond < 16; cond++)
+		if((set >> cond & 1) && (cond & ~free_bits) != all)
+			cube = 0;
+
+	if(cube)
+	{
+		for(int bit = 3; bit >= 0; bit--)
+			*text++ = free_bits >> bit & 1 ? '-' : all >> bit & 1 ? '1' : '0';
+		*text = 0;
+		return;
+	}
+	const char *separator = "";
+	for(int cond = 0; cond < 16; cond++)
+		if(set >> cond & 1)
+		{
+			text += sprintf(text, "%s%x", separator, cond);
+			separator = ",";
+		}
+}
+
+void write_listing(const char *file_name, const struct control_store *cs, const struct microcode_def *def, int interrupts)
+{
+	FILE *fPtr = fopen(file_name, "w");
+	int lines = 0;
+
+	if(fPtr == NULL)
+	{
+		printf("Unable to create file %s.\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	setvbuf(fPtr, NULL, _IOFBF, 1 << 20);
+	fprintf(fPtr, "%-4s  %-10s %2s  %-4s %-8s %-*s  %-24s %s\n", "addr", "opcode", "ir", "step", "ZNCI", CONTROL_CHIPS * 2, "word",
+		"source", "signals");
+	for(int row = 0; row < EEPROM_SIZE; row += 16)
+	{
+		unsigned listed = 0;
+		int used = 0;
+		for(int addr = row; addr < row + 16; addr++)
+			if(cs->written ? cs->written[addr >> 3] >> (addr & 7) & 1 : cs->words[addr] != FILL_WORD)
+				used = 1;
+		if(!used)
+			continue;
+
+		for(int cond = 0; cond < 16; cond++)
+		{
+			control_word word = cs->words[row | cond];
+			unsigned set = 0;
+			char conditions[48];
+			if(listed >> cond & 1)
+				continue;
+			for(int other = cond; other < 16; other++)
+				if(cs->words[row | other] == word)
+					set |= 1u << other;
+			listed |= set;
+			format_conditions(conditions, set);
+
+			char label[16];
+			fprintf(fPtr, "%04x  %-10s %02x  S%-3d %-8s %0*llx  ", row | cond, step_opcode_name(row >> 8, label, sizeof(label)),
+				row >> 8, (row >> 4) & 0xF, conditions, CONTROL_CHIPS * 2, (unsigned long long) word);
+			print_source(fPtr, def, row | cond, word, interrupts);
+			fprintf(fPtr, "  ");
+			print_signals(fPtr, word);
+			fprintf(fPtr, "\n");
+			lines++;
+		}
+	}
+	if(fclose(fPtr) != 0)
+	{
+		printf("oh no, the write failed for %s!!!\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	printf("%s: %d lines\n", file_name, lines);
+}
+
+/*
+search for an opcode encoding. a candidate places every opcode family (the upper nibble of the ir, NOP stays at 0
+where the interrupt dispatch expects it) on a nibble and permutes the mode bits of the low nibble, the jumps keep
+theirs since they select the flags. ir1 (address bit 9) stays where it is, FAST_FETCH drives it outside the jump group.
+every opcode keeps its own sequence under any encoding, so the cycles of a program are the same for all of them;
+what the encoding changes is how many step rows the opcodes can share. that is scored per step as the cubes over
+the 8 ir bits that cover the opcodes with one row each (a step no entry writes and an unused ir are don't care),
+the rows a decoder or a folded layout needs. layouts where opcodes share a suffix of their steps are not searched,
+that would change the sequences.
+every worker runs threshold accepting (annealing with a falling threshold instead of exp()) from its own seed
+*/
+#define SEARCH_STEPS 20000 //candidates per worker
+
+struct encoding{
+	uint8_t nibble[16]; //new upper nibble of every old one
+	uint8_t mode[4];    //new position of every mode bit, not for the jumps, FAST_FETCH_MODE stays in place
+};
+
+#define FAST_FETCH_MODE 1 //the mode bit of the low ir nibble FAST_FETCH drives
+MC_STATIC_ASSERT(FAST_FETCH == 1 << (8 + FAST_FETCH_MODE), "the encoding search pins the wrong mode bit");
+
+struct search{
+	uint64_t row[256][16];  //hash of the 16 words of every step of every ir, 0 where no entry writes the step
+	int used[256];
+	int jump_family;
+	struct encoding best;   //of this worker
+	int best_rows;
+	uint32_t seed;
+	long evaluated;
+};
+
+static int encode_ir(const struct encoding *e, int jump_family, int ir)
+{
+	int family = ir >> 4, mode = ir & 0xF, to = 0;
+
+	if(family == jump_family)
+		return e->nibble[family] << 4 | mode;
+	for(int bit = 0; bit < 4; bit++)
+		if(mode >> bit & 1)
+			to |= 1 << e->mode[bit];
+	return e->nibble[family] << 4 | to;
+}
+
+// step rows of the control store under encoding e, the greedy cube cover of every step
+static int count_rows(const struct search *sr, const struct encoding *e)
+{
+	uint64_t row[256];
+	uint8_t covered[256];
+	int rows = 0;
+
+	for(int step = 0; step < 16; step++)
+	{
+		memset(row, 0, sizeof(row));
+		memset(covered, 0, sizeof(covered));
+		for(int ir = 0; ir < 256; ir++)
+			if(sr->used[ir])
+				row[encode_ir(e, sr->jump_family, ir)] = sr->row[ir][step];
+
+		for(int ir = 0; ir < 256; ir++)
+		{
+			if(row[ir] == 0 || covered[ir])
+				continue;
+			unsigned free_bits = 0;
+			for(int bit = 0; bit < 8; bit++)
+			{
+				unsigned grown = free_bits | 1u << bit, x = 0;
+				int fits = 1;
+				do
+				{
+					uint64_t other = row[(ir & ~grown) | x];
+					if(other != 0 && other != row[ir])
+						fits = 0;
+					x = (x - grown) & grown;
+				}while(fits && x != 0);
+				if(fits)
+					free_bits = grown;
+			}
+			unsigned x = 0;
+			do
+			{
+				covered[(ir & ~free_bits) | x] = 1;
+				x = (x - free_bits) & free_bits;
+			}while(x != 0);
+			rows++;
+		}
+	}
+	return rows;
+}
+
+static void *search_main(void *arg)
+{
+	struct search *sr = arg;
+	struct encoding at = sr->best;
+	int rows = sr->best_rows, threshold = rows / 20 + 1;
+
+	for(int i = 0; i < SEARCH_STEPS; i++)
+	{
+		struct encoding next = at;
+		uint32_t r = next_random(&sr->seed);
+		if(r & 1)
+		{
+			int a = 1 + (r >> 1) % 15, b = 1 + (r >> 5) % 15; //nibble 0 stays with NOP
+			uint8_t keep = next.nibble[a];
+			next.nibble[a] = next.nibble[b];
+			next.nibble[b] = keep;
+		}
+		else
+		{
+			static const uint8_t movable[3] = {0, 2, 3}; //every mode bit but FAST_FETCH_MODE
+			int a = movable[(r >> 1) % 3], b = movable[(r >> 3) % 3];
+			uint8_t keep = next.mode[a];
+			next.mode[a] = next.mode[b];
+			next.mode[b] = keep;
+		}
+		int next_rows = count_rows(sr, &next);
+		sr->evaluated++;
+		if(next_rows <= rows + threshold * (SEARCH_STEPS - i) / SEARCH_STEPS)
+		{
+			at = next;
+			rows = next_rows;
+			if(rows < sr->best_rows)
+			{
+				sr->best = at;
+				sr->best_rows = rows;
+			}
+		}
+	}
+	return NULL;
+}
+
+static const struct opcode_name encoded_names[] = {
+	{"NOP", NOP}, {"STP", STP}, {"RSF", RSF},
+	{"ADD", ADD}, {"ADDI", ADDI}, {"SUB", SUB}, {"SUBI", SUBI},
+	{"NOT", NOT}, {"XOR", XOR}, {"XORI", XORI}, {"ORR", ORR}, {"ORRI", ORRI}, {"AND", AND}, {"ANDI", ANDI},
+	{"JMP", JMP}, {"JMPB", JMPB},
+	{"LDA", LDA}, {"MOVA", MOVA}, {"LDAB", LDAB}, {"LDB", LDB}, {"MOVB", MOVB}, {"LDBB", LDBB},
+	{"LDC", LDC}, {"MOVC", MOVC}, {"LDCB", LDCB}, {"STC", STC}, {"STCB", STCB},
+	{"RTI", RTI},
+	{NULL, -1}
+};
+
+int search_encoding(const control_word *store, const uint8_t *written, const char *file_name, int workers)
+{
+	struct timespec t_start, t_end;
+	struct encoding identity;
+	long evaluated = 0;
+	int best = 0;
+
+	printf("the score is the step rows of this layout, layouts where opcodes share a suffix of their steps are not searched\n");
+
+	struct search *sr = malloc(workers * sizeof(*sr));
+	pthread_t *threads = calloc(workers, sizeof(pthread_t));
+	if(sr == NULL || threads == NULL)
+	{
+		printf("out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	for(int i = 0; i < 16; i++)
+		identity.nibble[i] = (uint8_t) i;
+	for(int i = 0; i < 4; i++)
+		identity.mode[i] = (uint8_t) i;
+	sr[0].jump_family = IR_OF(JMP) >> 4;
+	for(int ir = 0; ir < 256; ir++)
+	{
+		sr[0].used[ir] = 0;
+		for(int step = 0; step < 16; step++)
+		{
+			int base = ir << 8 | step << 4;
+			uint64_t hash = 0;
+			for(int cond = 0; cond < 16; cond++)
+				if(written ? written[(base | cond) >> 3] >> (cond & 7) & 1 : store[base | cond] != FILL_WORD)
+					hash = 1;
+			if(hash)
+				hash = hash_image((const uint8_t *) &store[base], 16 * sizeof(control_word)) | 1;
+			sr[0].row[ir][step] = hash;
+			sr[0].used[ir] |= hash != 0;
+		}
+	}
+	sr[0].best = identity;
+	sr[0].best_rows = count_rows(&sr[0], &identity);
+	printf("searching %d encodings on %d thread%s, the current one needs %d step rows\n", SEARCH_STEPS * workers, workers,
+		workers == 1 ? "" : "s", sr[0].best_rows);
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	for(int w = 0; w < workers; w++)
+	{
+		if(w)
+			memcpy(&sr[w], &sr[0], sizeof(sr[0]));
+		sr[w].seed = 0x2545F491u + 0x9E3779B9u * (uint32_t) w;
+		sr[w].evaluated = 0;
+		if(pthread_create(&threads[w], NULL, search_main, &sr[w]) != 0)
+		{
+			printf("unable to start worker thread %d\n", w);
+			exit(EXIT_FAILURE);
+		}
+	}
+	for(int w = 0; w < workers; w++)
+	{
+		pthread_join(threads[w], NULL);
+		evaluated += sr[w].evaluated;
+		if(sr[w].best_rows < sr[best].best_rows)
+			best = w;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+	double ms = elapsed_ms(t_start, t_end);
+	printf("%ld candidates in %.3f ms, %.0f per second\n", evaluated, ms, ms > 0 ? evaluated * 1000.0 / ms : 0.0);
+
+	const struct encoding *e = &sr[best].best;
+	FILE *fPtr = fopen(file_name, "w");
+	if(fPtr == NULL)
+	{
+		printf("Unable to create file %s.\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	printf("best encoding needs %d step rows, written to %s\n", sr[best].best_rows, file_name);
+	printf("  %-10s %6s %6s\n", "opcode", "old", "new");
+	fprintf(fPtr, "/* opcode encoding found by microcode_generator -S, %d step rows */\n", sr[best].best_rows);
+	for(int i = 0; encoded_names[i].name; i++)
+	{
+		int from = IR_OF(encoded_names[i].input), to = encode_ir(e, sr[best].jump_family, from);
+		if(!sr[best].used[from])
+		{
+			//no row to share, its place only has to stay clear of the others
+			printf("  %-10s 0x%02x00 0x%02x00 not generated\n", encoded_names[i].name, from, to);
+			fprintf(fPtr, "#define %s 0x%02X00 //not generated by these tables\n", encoded_names[i].name, to);
+			continue;
+		}
+		printf("  %-10s 0x%02x00 0x%02x00\n", encoded_names[i].name, from, to);
+		fprintf(fPtr, "#define %s 0x%02X00\n", encoded_names[i].name, to);
+	}
+	fprintf(fPtr, "#define MMIO 0x%04X\n", encode_ir(e, -1, IR_OF(MMIO)) << 8);
+	fprintf(fPtr, "#define BYTE_ADDRESSING_MODE 0x%04X\n", encode_ir(e, -1, IR_OF(BYTE_ADDRESSING_MODE)) << 8);
+	fprintf(fPtr, "#define FAST_FETCH 0x%04X //pinned, the latch is wired to this line\n", encode_ir(e, -1, IR_OF(FAST_FETCH)) << 8);
+	if(fclose(fPtr) != 0)
+	{
+		printf("oh no, the write failed for %s!!!\n", file_name);
+		exit(EXIT_FAILURE);
+	}
+	free(sr);
+	free(threads);
+	return 0;
+}
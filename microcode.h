@@ -0,0 +1,144 @@
+/*
+breadboard cpu micro code: the built in micro code tables and the control store generator as a library. a tool builds the control store into an arena it owns and reads the words and the chip images in
+place, nothing is copied and no file is written. microcode_generator is the command line front end of it.
+
+	struct arena arena;
+	arena_init(&arena, control_store_footprint());
+	struct control_store *cs = build_microcode(&arena, &builtin_def, &(struct build_options){0});
+	struct byte_span chip0 = chip_plane(cs, 0);  //chip0.data[addr], chip0.size == MC_EEPROM_SIZE
+	...
+	arena_free(&arena);
+
+a store stays valid until its arena is reset or freed, any number of arenas can build at the same time
+
+the opcode, step, condition and signal names used to write tables are in microcode_tables.h, which this header
+does not include: its one letter conditions and bare mnemonics (I, C, NOP, WRITE) collide with other headers
+*/
+#ifndef MICROCODE_H
+#define MICROCODE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MC_EEPROM_SIZE 65536 //addresses of the control store, bytes of every chip image
+#define MC_PAGE_SIZE 64 //EEPROM write page, the unit the programmer burns in one go
+
+//control word: CONTROL_CHIPS 8 bit rom slices, chip n drives bits 8n..8n+7 (build with -DCONTROL_CHIPS=4 for a fourth)
+#ifndef CONTROL_CHIPS
+#define CONTROL_CHIPS 3
+#endif
+#define CONTROL_BITS (CONTROL_CHIPS * 8)
+
+typedef uint64_t control_word;
+
+struct micro_code{
+	int32_t input;  //16 bit should be enough, but i want negative to indicate if a array reach the end
+	control_word output; //CONTROL_BITS control signal
+	int32_t care;   //address bits the entry has to match, 0 means CARE_DEFAULT of microcode_tables.h (every condition value)
+};
+
+/*
+micro code definition: the two tables build_control_store expands, either the built in ones
+or a text definition loaded with load_definition
+*/
+struct microcode_def{
+	const char *name;
+	struct micro_code *list;  //ends with input -1
+	struct micro_code *jump;  //jump_template, expanded for every JMP_C/JMP_N/JMP_Z combination, ends with input -1
+};
+
+extern const struct microcode_def builtin_def;
+
+// parse a definition file, errors go to out with their location, returns the number of errors
+int load_definition(const char *file_name, struct microcode_def *def, FILE *out);
+void free_definition(struct microcode_def *def);
+
+//bump allocator, everything of a control store lives in one block that is released at once
+struct arena{
+	uint8_t *base;
+	size_t size, used;
+};
+
+//read only views into an arena, valid until it is reset or freed
+struct word_span{
+	const control_word *data;
+	size_t size;
+};
+
+struct byte_span{
+	const uint8_t *data;
+	size_t size;
+};
+
+// how much build_microcode reports, each level includes the ones above it
+enum mc_log_level{
+	MC_LOG_ERROR,  //table errors, why no image was generated
+	MC_LOG_WARN,   //micro code that generates but looks wrong, steps nothing reaches
+	MC_LOG_INFO,   //the passes that ran and their totals
+	MC_LOG_DEBUG,  //one line per opcode of every pass
+	MC_LOG_TRACE,  //every address filled, with the entry that filled it
+};
+
+struct build_options{
+	int compact;     //merge micro steps, -o
+	int fast_fetch;  //-f
+	int overlap;     //-O
+	int interrupts;  //-i
+	int verbosity;   //enum mc_log_level, 0 only reports errors
+	FILE *out;       //reports and errors, NULL for stdout
+};
+
+struct control_store;
+
+void arena_init(struct arena *arena, size_t size); //out of memory is fatal
+void *arena_alloc(struct arena *arena, size_t size); //64 byte aligned, NULL once the arena is full
+void arena_reset(struct arena *arena);
+void arena_free(struct arena *arena);
+size_t control_store_footprint(void); //arena bytes one control store takes
+
+// generate from def, NULL after reporting a table error (the arena is left as it was)
+struct control_store *build_microcode(struct arena *arena, const struct microcode_def *def, const struct build_options *options);
+// rebuild a control store from chip0.bin..chipN.bin
+struct control_store *load_chip_images(struct arena *arena);
+
+struct word_span control_words(const struct control_store *cs);  //MC_EEPROM_SIZE words
+struct byte_span chip_plane(const struct control_store *cs, int chip); //MC_EEPROM_SIZE byte image of one chip
+const uint8_t *occupancy(const struct control_store *cs); //one bit per address written by the tables, NULL for loaded images
+
+//files
+void write_file(const char *file_name, const void *data, size_t size);
+int write_incremental(const char *file_name, const char *patch_name, const uint8_t *image);
+void write_rom_header(const char *file_name, const struct control_store *cs);
+int write_compressed(const struct control_store *cs);
+int verify_dumps(const char *prefix, const struct control_store *cs, const struct microcode_def *def, int interrupts);
+// one line per micro step and condition group with its source entry and signal names
+void write_listing(const char *file_name, const struct control_store *cs, const struct microcode_def *def, int interrupts);
+
+//analysis and the emulator, written to stdout
+int fold_control_store(const control_word *store, const uint8_t *written, int size);
+int write_pla_equations(const control_word *store, const uint8_t *written, const char *file_name);
+void timing_report(const control_word *store, const uint8_t *written, const char *delay_file);
+void print_interrupt_latency(const control_word *store);
+void print_cpi_table(const control_word *store);
+void weigh_trace(const control_word *store, const char *trace);
+void run_program(const control_word *store, const char *program, uint64_t max_steps, int profiled, int fast_fetch,
+	uint32_t interrupt_period);
+int run_batch(const char *file_name, int workers);
+// anneal the opcode encoding for the fewest step rows, writes the #defines
+int search_encoding(const control_word *store, const uint8_t *written, const char *file_name, int workers);
+int run_benchmark(int runs); //time the expansion, generation and output of the built in and a full synthetic table
+int check_golden(void);      //hash the images of the golden variants, returns how many differ
+
+double elapsed_ms(struct timespec from, struct timespec to); //between two clock_gettime readings
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
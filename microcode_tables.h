@@ -0,0 +1,252 @@
+/*
+opcode, step, condition and signal names of the breadboard cpu for writing micro code tables, with the checks of
+the address layout and the control word. microcode.c and anything that builds its own struct microcode_def include
+this, the library interface alone is microcode.h
+*/
+#ifndef MICROCODE_TABLES_H
+#define MICROCODE_TABLES_H
+
+#include "microcode.h"
+
+#define EEPROM_SIZE MC_EEPROM_SIZE
+
+//compile time checks of the layout below. C++ has static_assert from C++11, before that an array of negative size stops the build
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#define MC_STATIC_ASSERT(condition, message) static_assert(condition, message)
+#elif defined(__cplusplus)
+#define MC_STATIC_ASSERT(condition, message) typedef char mc_static_assert[(condition) ? 1 : -1]
+#else
+#define MC_STATIC_ASSERT(condition, message) _Static_assert(condition, message)
+#endif
+#define UNUSED_FILL 0x00 //value of every address no micro code is written to, decode as NS0 with no control signal so a stray address goes back to fetch
+
+// any address is made up of opcode(bit 15-12), step(bit 11-8) and condition code (bit 7-0)
+// any data are 1 byte in size,  output 8 control bits.
+
+/*opcode:
+shift left 8 bit because opcode is from bit 12 to 15
+shift left 4 bit because opcode is because they are the upper 4 bit. Lower 4 bit are reserved for config bit
+*/
+//arithmetic
+#define NOP 0x0000
+#define STP 0x0800
+#define RSF 0x1000
+#define ADD 0x2000 
+#define ADDI 0x2800
+#define SUB 0x3000 
+#define SUBI 0x3800
+#define NOT 0x4000
+#define XOR 0x5000
+#define XORI 0x5800
+#define ORR 0x6000
+#define ORRI 0x6800
+#define AND 0x7000
+#define ANDI 0x7800
+
+//flow control
+#define JMP 0x8000 //1000
+#define JMPB 0x8800
+#define JMP_C 0x0100
+#define JMP_N 0x0200
+#define JMP_Z 0x0400
+#define JZ JMP+JMP_Z
+#define JN JMP+JMP_N
+#define JC JMP+JMP_C
+#define JZN JMP + JMP_Z + JMP_N
+#define JZC JMP + JMP_Z + JMP_C
+#define JNC JMP + JMP_N + JMP_C
+#define JZNC JMP + JMP_Z + JMP_N + JMP_C
+
+//data movement (load store)
+#define LDA 0xA000 //1010
+#define MOVA 0xA400
+#define LDAB 0xA800 //not done
+#define LDB 0xB000 //1011
+#define MOVB 0xB400
+#define LDBB 0xB800 //not done
+#define LDC 0xC000 //1100
+#define MOVC 0xC400
+#define LDCB 0xC800 //not done
+#define STC 0xD000 //1101
+#define STCB 0xD800 //not done
+
+//interrupt
+#define RTI 0x9000 //return from interrupt, see interrupt_list
+
+
+#define MMIO 0x0100 // memory mapped IO
+#define BYTE_ADDRESSING_MODE 0x0800
+
+
+//condition code & interrupt
+#define I 0x1
+#define C 0x2
+#define N 0x4
+#define Z 0x8
+#define MEM_READY 0x4
+
+/*
+FAST_FETCH is latched at S0 when MAR1 already holds the higher address of pc and the next FAST_FETCH_SPAN byte stay
+in this page (pc0 <= 0x100 - FAST_FETCH_SPAN), so there is no need to load the 0x10 part of pc 0x1000 into the MAR1
+again when PC increment.
+0x80 is STEP3 in this address layout, the fast forms would land on S8-S15 of LDx/STC/JMP. every other address bit is
+taken too, so the latch drives mode bit ir1 (address bit 9), which only the jump group uses (JMP_N).
+
+-f needs this on the board, it is not part of the current hardware: a flip-flop clocked at the end of S0 holding
+(MAR1 == pc1) && (pc0 <= 0x100 - FAST_FETCH_SPAN), and a 2 to 1 mux putting it on address line 9 instead of ir1
+while ir is outside the jump group. for the jump group the line stays ir1 and the latch is not set at its S0,
+see derive_fast_fetch()
+*/
+#define FAST_FETCH 0x0200
+#define FAST_FETCH_ROUTED(ir) (((ir) & 0xF0) != JMP >> 8)
+#define FAST_FETCH_SPAN 3 //byte of the longest instruction, the page check of the latch
+
+
+//step
+#define S0 0x00
+#define S1 0x10
+#define S2 0x20
+#define S3 0x30
+#define S4 0x40
+#define S5 0x50
+#define S6 0x60
+#define S7 0x70
+#define S8 0x80
+#define S9 0x90
+#define S10 0xA0
+#define S11 0xB0
+#define S12 0xC0
+#define S13 0xD0
+#define S14 0xE0
+#define S15 0xF0
+
+/*
+control word: CONTROL_CHIPS 8 bit rom slices, chip n drives bits 8n..8n+7, so a signal's bit position is also its
+chip and pin. the signal table is the only place a signal is placed, the value defines below, the names in
+the reports and the pla pins, and the symbols of a definition file all come from it.
+fields (ALU, STEP) take consecutive pins named from their lowest bit.
+with a fourth chip (build with -DCONTROL_CHIPS=4) ADD_INC gets a pin of its own, with three it is the LOAD_IO pin,
+read as the carry in while the alu runs
+*/
+#define SIGNAL_TABLE(X) \
+	/* right chip */ \
+	X(WRITE_IO, 0)  X(GATE_IO, 1)   X(LOAD_IO, 2)    X(INCR_PC, 3) \
+	X(GATE_PC1, 4)  X(GATE_PC0, 5)  X(LOAD_PC1, 6)   X(LOAD_PC0, 7) \
+	/* middle chip */ \
+	X(ALU0, 8)      X(ALU1, 9)      X(ALU2, 10)      X(GATE_C, 11) \
+	X(LOAD_C, 12)   X(LOAD_B, 13)   X(LOAD_A, 14)    X(LOAD_IR, 15) \
+	/* left chip */ \
+	X(WRITE, 16)    X(GATE_MEM, 17) X(LOAD_MAR1, 18) X(LOAD_MAR0, 19) \
+	X(STEP0, 20)    X(STEP1, 21)    X(STEP2, 22)     X(STEP3, 23) \
+	EXTRA_SIGNALS(X)
+
+#if CONTROL_CHIPS > 3
+#define EXTRA_SIGNALS(X) \
+	/* fourth chip */ \
+	X(ADD_INC, 24)
+#else
+#define EXTRA_SIGNALS(X)
+#endif
+
+#define SIGNAL_POSITION(name, at) name##_AT = (at),
+enum signal_position{ SIGNAL_TABLE(SIGNAL_POSITION) };
+#undef SIGNAL_POSITION
+
+#define SIGNAL(name) ((control_word) 1 << name##_AT)
+#define FIELD(first, value) ((control_word) (value) << first##_AT)
+
+#define SIGNAL_FITS(name, at) MC_STATIC_ASSERT((at) < CONTROL_BITS, #name " is past the last chip");
+SIGNAL_TABLE(SIGNAL_FITS)
+#undef SIGNAL_FITS
+MC_STATIC_ASSERT(CONTROL_CHIPS >= 3 && CONTROL_CHIPS <= 8, "the control word is 3 to 8 chips");
+MC_STATIC_ASSERT(ALU1_AT == ALU0_AT + 1 && ALU2_AT == ALU0_AT + 2, "the alu field is not on consecutive pins");
+MC_STATIC_ASSERT(STEP1_AT == STEP0_AT + 1 && STEP2_AT == STEP0_AT + 2 && STEP3_AT == STEP0_AT + 3,
+	"the step field is not on consecutive pins");
+
+//every pin driven by one signal: the sum of the signal bits is their or only when no two share a pin
+#define SIGNAL_SUM(name, at) + SIGNAL(name)
+#define SIGNAL_OR(name, at) | SIGNAL(name)
+MC_STATIC_ASSERT((0 SIGNAL_TABLE(SIGNAL_SUM)) == (0 SIGNAL_TABLE(SIGNAL_OR)), "two signals share a pin");
+#undef SIGNAL_SUM
+#undef SIGNAL_OR
+
+#define CONTROL_MASK (CONTROL_BITS == 64 ? ~(control_word) 0 : ((control_word) 1 << (CONTROL_BITS % 64)) - 1)
+#define FILL_WORD ((control_word) UNUSED_FILL * (CONTROL_MASK / 0xFF)) //UNUSED_FILL in every chip
+
+//next step
+#define NS0 FIELD(STEP0, 0)
+#define NS1 FIELD(STEP0, 1)
+#define NS2 FIELD(STEP0, 2)
+#define NS3 FIELD(STEP0, 3)
+#define NS4 FIELD(STEP0, 4)
+#define NS5 FIELD(STEP0, 5)
+#define NS6 FIELD(STEP0, 6)
+#define NS7 FIELD(STEP0, 7)
+#define NS8 FIELD(STEP0, 8)
+#define NS9 FIELD(STEP0, 9)
+#define NS10 FIELD(STEP0, 10)
+#define NS11 FIELD(STEP0, 11)
+#define NS12 FIELD(STEP0, 12)
+#define NS13 FIELD(STEP0, 13)
+#define NS14 FIELD(STEP0, 14)
+#define NS15 FIELD(STEP0, 15)
+#define NSJUMP NS15 //old name of NS15, only kept for definition files
+#define STEP3 SIGNAL(STEP3)
+#define STEP2 SIGNAL(STEP2)
+#define STEP1 SIGNAL(STEP1)
+#define STEP0 SIGNAL(STEP0)
+
+#define LOAD_MAR0 SIGNAL(LOAD_MAR0)//EEPROM
+#define LOAD_MAR1 SIGNAL(LOAD_MAR1)//EEPROM
+#define GATE_MEM SIGNAL(GATE_MEM)//EEPROM
+#define WRITE SIGNAL(WRITE)//EEPROM
+
+#define LOAD_IR SIGNAL(LOAD_IR)//Control Unit
+
+#define LOAD_A SIGNAL(LOAD_A)//ALU
+#define LOAD_B SIGNAL(LOAD_B)//ALU
+#define LOAD_C SIGNAL(LOAD_C)//ALU
+#define GATE_C SIGNAL(GATE_C)//ALU
+#define ALU2 SIGNAL(ALU2)//ALU
+#define ALU1 SIGNAL(ALU1)//ALU
+#define ALU0 SIGNAL(ALU0)//ALU
+
+#define ALU_NOP FIELD(ALU0, 0)
+#define ALU_SHF FIELD(ALU0, 1)
+#define ALU_ADD FIELD(ALU0, 2)
+#define ALU_SUB FIELD(ALU0, 3)
+#define ALU_NOT FIELD(ALU0, 4)
+#define ALU_XOR FIELD(ALU0, 5)
+#define ALU_ORR FIELD(ALU0, 6)
+#define ALU_AND FIELD(ALU0, 7)
+#define ALU_OP(word) (((word) >> ALU0_AT) & 7)
+MC_STATIC_ASSERT(ALU_OP(ALU_SHF) == 1 && ALU_OP(ALU_ADD) == 2 && ALU_OP(ALU_SUB) == 3 && ALU_OP(ALU_AND) == 7
+	&& (ALU_AND == (ALU2|ALU1|ALU0)), "ALU_OP does not decode the alu field of SIGNAL_TABLE");
+
+#define LOAD_PC0 SIGNAL(LOAD_PC0)//Program Counter
+#define LOAD_PC1 SIGNAL(LOAD_PC1)//Program Counter
+#define GATE_PC0 SIGNAL(GATE_PC0)//Program Counter
+#define GATE_PC1 SIGNAL(GATE_PC1)//Program Counter
+#define INCR_PC SIGNAL(INCR_PC)//Program Counter
+
+#define LOAD_IO SIGNAL(LOAD_IO)//IO
+#define GATE_IO SIGNAL(GATE_IO)//IO
+#define WRITE_IO SIGNAL(WRITE_IO)//IO
+
+#if CONTROL_CHIPS > 3
+#define ADD_INC SIGNAL(ADD_INC) //carry in of the alu, used for increment add
+#else
+#define ADD_INC LOAD_IO //control signal overload with load_io, used for increment add
+#endif
+
+//care masks: opcode, mode and step always matter, WHEN(C) also splits the entry on the carry bit
+#define CARE_DEFAULT 0xFFF0
+#define WHEN(cond) (CARE_DEFAULT | (cond))
+
+//the fields of the address must not overlap, checked at compile time (the control word is checked with the signal table)
+MC_STATIC_ASSERT(((S15|S1|S2|S4|S8) & (I|C|N|Z)) == 0, "step field overlaps the condition bits");
+MC_STATIC_ASSERT(((S15) & (MMIO|BYTE_ADDRESSING_MODE|JMP_C|JMP_N|JMP_Z)) == 0, "step field overlaps the mode bits");
+
+#define NEXT_STEP(word) ((int) ((word) >> STEP0_AT) & 0xF)
+
+#endif